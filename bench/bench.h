@@ -0,0 +1,86 @@
+// Общая часть исполняемых файлов lab_N_bench: задержка каждой операции
+// и пропускная способность. Подключается из main.cpp лабораторных при LAB_BENCHMARK
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Итоги замера одной операции, задержки в микросекундах
+struct LatencyReport {
+    std::size_t operations = 0;
+    std::size_t bytes = 0;     // Объём входа одной операции, 0 - МБ/с не выводится
+    std::size_t checksum = 0;  // Сумма результатов операций: совпадает во всех сборках
+    double seconds = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+// Замер: warmup прогонов без учёта, затем count прогонов, каждый со своей
+// меткой времени. operation(i) возвращает число, которое идёт в checksum,
+// чтобы компилятор не выбросил вычисления
+template <typename Operation>
+LatencyReport measureLatency(std::size_t count, std::size_t bytes, Operation operation, std::size_t warmup = 3) {
+    LatencyReport report;
+    for (std::size_t i = 0; i < warmup; i++) {
+        report.checksum += operation(i);
+    }
+    report.checksum = 0;
+
+    std::vector<double> samples(count);
+    auto total = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i++) {
+        auto start = std::chrono::steady_clock::now();
+        report.checksum += operation(i);
+        samples[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - total).count();
+    report.operations = count;
+    report.bytes = bytes;
+
+    if (count > 0) {
+        std::sort(samples.begin(), samples.end());
+        // Процентиль по ближайшему рангу
+        auto percentile = [&](double p) {
+            std::size_t rank = std::size_t(p * count + 0.5);
+            return samples[std::min(rank > 0 ? rank - 1 : 0, count - 1)];
+        };
+        report.p50 = percentile(0.50);
+        report.p90 = percentile(0.90);
+        report.p99 = percentile(0.99);
+        report.max = samples.back();
+    }
+    return report;
+}
+
+inline void printLatencyHeader(std::ostream& out) {
+    out << "Тест\tОпераций\tОпер/с\tМБ/с\tp50, мкс\tp90, мкс\tp99, мкс\tМакс, мкс\tКонтроль\n";
+}
+
+inline void printLatency(std::ostream& out, const std::string& name, const LatencyReport& report) {
+    out << name << "\t" << report.operations << "\t" << report.operations / report.seconds << "\t";
+    if (report.bytes) {
+        out << report.bytes * report.operations / report.seconds / 1048576.0;
+    } else {
+        out << "-";
+    }
+    out << "\t" << report.p50 << "\t" << report.p90 << "\t" << report.p99 << "\t" << report.max
+        << "\t" << report.checksum << std::endl;
+}
+
+// Множитель объёма входов: lab_N_bench [множитель], по умолчанию 1
+inline double benchScale(int argc, char* argv[]) {
+    return argc >= 2 ? std::max(std::atof(argv[1]), 0.01) : 1.0;
+}
+
+// Число операций с учётом множителя, не меньше одной
+inline std::size_t scaled(std::size_t count, double scale) {
+    return std::max<std::size_t>(std::size_t(count * scale), 1);
+}
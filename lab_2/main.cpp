@@ -8,6 +8,13 @@
 #include <sstream>
 #include <unordered_set>
 #include <algorithm>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#ifdef LAB_BENCHMARK
+#include "../bench/bench.h"
+#endif
 
 using namespace std;
 
@@ -34,25 +41,46 @@ public:
     }
 };
 
-// Класс для представления перехода между состояниями автомата
+// Класс для представления перехода между состояниями автомата.
+// Переход идёт по диапазону байтов [symbol, last]; у перехода по одному
+// символу last совпадает с symbol
 class Transition {
 public:
     State from;
     char symbol;
+    char last;
     State to;
 
     // Конструктор перехода
-    Transition(const State& from, char symbol, const State& to) : from(from), symbol(symbol), to(to) {}
+    Transition(const State& from, char symbol, const State& to) : from(from), symbol(symbol), last(symbol), to(to) {}
 
+    // Переход по диапазону байтов от symbol до last включительно
+    Transition(const State& from, char symbol, char last, const State& to) : from(from), symbol(symbol), last(last), to(to) {}
+
+    bool covers(char c) const {
+        return (unsigned char)c >= (unsigned char)symbol && (unsigned char)c <= (unsigned char)last;
+    }
+
+    // Символ или диапазон в формате файла автомата: a или [a-z]
+    string label() const {
+        auto text = [](char c) {
+            if (c >= ' ' && c <= '~') {
+                return string(1, c);
+            }
+            static const char* const digits = "0123456789ABCDEF";
+            return string("\\x") + digits[(unsigned char)c >> 4] + digits[c & 15];
+        };
+        return symbol == last ? text(symbol) : "[" + text(symbol) + "-" + text(last) + "]";
+    }
     
     bool operator<(const Transition& other) const {
         // Сначала сравниваем по полю from (по состоянию, из которого исходит переход)
         if (from < other.from) return true;
         if (other.from < from) return false;
 
-        // Затем сравниваем по символу перехода
-        if (symbol < other.symbol) return true;
-        if (other.symbol < symbol) return false;
+        // Затем сравниваем по символам перехода как по байтам без знака
+        if ((unsigned char)symbol != (unsigned char)other.symbol) return (unsigned char)symbol < (unsigned char)other.symbol;
+        if ((unsigned char)last != (unsigned char)other.last) return (unsigned char)last < (unsigned char)other.last;
 
         // И наконец, сравниваем по полю to (по состоянию, в которое осуществляется переход)
         return to < other.to;
@@ -92,12 +120,19 @@ public:
 
     // Проверка, является ли автомат детерминированным
     bool isDeterministic() const {
-        map<State, map<char, State>> transitionMap;
+        // Переходы упорядочены по состоянию и началу диапазона, поэтому
+        // достаточно помнить самый дальний конец диапазонов текущего состояния
+        const State* from = nullptr;
+        int reach = -1;
         for (const Transition& transition : transitions) {
-            if (transitionMap[transition.from].count(transition.symbol)) {
-                return false;  // если существует несколько переходов с одинаковым символом, автомат не детерминирован
+            if (!from || !(*from == transition.from)) {
+                from = &transition.from;
+                reach = -1;
             }
-            transitionMap[transition.from][transition.symbol] = transition.to;
+            if ((unsigned char)transition.symbol <= reach) {
+                return false;  // если диапазоны переходов из состояния пересекаются, автомат не детерминирован
+            }
+            reach = (unsigned char)transition.last;
         }
         return true;
     }
@@ -112,6 +147,9 @@ public:
         newStates[initialSet] = State(getStateName(initialSet), isFinal(initialSet));
         deterministicFA.addState(newStates[initialSet]);
         deterministicFA.setInitialState(newStates[initialSet]);
+        if (isFinal(initialSet)) {
+            deterministicFA.addFinalState(newStates[initialSet]);
+        }
 
         // Основной алгоритм детерминизации
         while (!queue.empty()) {
@@ -119,19 +157,43 @@ public:
             queue.pop();
             State currentState = newStates[currentSet];
 
-            map<char, set<State>> transitionsMap;
+            // Границы диапазонов делят байты на отрезки, внутри которых
+            // множество целей одно и то же
+            vector<const Transition*> outgoing;
+            set<int> bounds;
             for (const State& state : currentSet) {
                 for (const Transition& transition : transitions) {
                     if (transition.from == state) {
-                        transitionsMap[transition.symbol].insert(transition.to);
+                        outgoing.push_back(&transition);
+                        bounds.insert((unsigned char)transition.symbol);
+                        bounds.insert((unsigned char)transition.last + 1);
+                    }
+                }
+            }
+
+            // Соседние отрезки с одинаковыми целями сливаются в один переход
+            vector<pair<pair<int, int>, set<State>>> ranges;
+            for (auto bound = bounds.begin(); bound != bounds.end() && next(bound) != bounds.end(); ++bound) {
+                int first = *bound, last = *next(bound) - 1;
+                set<State> targets;
+                for (const Transition* transition : outgoing) {
+                    if (transition->covers(char(first))) {
+                        targets.insert(transition->to);
                     }
                 }
+                if (targets.empty()) {
+                    continue;
+                }
+                if (!ranges.empty() && ranges.back().first.second + 1 == first && ranges.back().second == targets) {
+                    ranges.back().first.second = last;
+                } else {
+                    ranges.push_back({{first, last}, targets});
+                }
             }
 
             // Обработка каждого перехода
-            for (const auto& entry : transitionsMap) {
-                char symbol = entry.first;
-                set<State> nextSet = entry.second;
+            for (const auto& entry : ranges) {
+                const set<State>& nextSet = entry.second;
                 if (!newStates.count(nextSet)) {
                     State newState = State(getStateName(nextSet), isFinal(nextSet));
                     newStates[nextSet] = newState;
@@ -141,7 +203,7 @@ public:
                     }
                     queue.push(nextSet);
                 }
-                deterministicFA.addTransition(Transition(currentState, symbol, newStates[nextSet]));
+                deterministicFA.addTransition(Transition(currentState, char(entry.first.first), char(entry.first.second), newStates[nextSet]));
             }
         }
 
@@ -154,7 +216,7 @@ public:
         for (char c : input) {
             bool foundTransition = false;
             for (const Transition& transition : transitions) {
-                if (transition.from == currentState && transition.symbol == c) {
+                if (transition.from == currentState && transition.covers(c)) {
                     currentState = transition.to;
                     foundTransition = true;
                     break;
@@ -192,6 +254,637 @@ private:
         return false;
     }
 };
+
+// Компилятор регулярных выражений по Томпсону. Синтаксис: символы, экранирование
+// \ (\d, \w, \s - классы цифр, букв и пробелов), . - любой байт, классы [a-z_]
+// и [^...], группы (), постфиксные *, +, ? и {n,m}, альтернатива |. Переходы строятся
+// сразу диапазонами байтов. ε-переходы конструкции Томпсона в FiniteAutomaton
+// не переносятся: состояние получает переходы всего своего ε-замыкания
+class RegexCompiler {
+public:
+    // Построение автомата по выражению; false и сообщение в cerr, если выражение некорректно
+    bool compile(const string& source, FiniteAutomaton& fa) {
+        pattern = source;
+        pos = 0;
+        error.clear();
+        nodes.clear();
+        Fragment whole = alternation();
+        if (error.empty() && pos < pattern.size()) {
+            fail("лишняя ')'");
+        }
+        if (!error.empty()) {
+            cerr << "Ошибка в регулярном выражении в позиции " << pos + 1 << ": " << error << endl;
+            return false;
+        }
+        fa = FiniteAutomaton();
+        build(whole, fa);
+        return true;
+    }
+
+private:
+    struct Range {
+        unsigned char first, last;
+    };
+
+    // Узел конструкции Томпсона: ε-переходы и переходы по диапазонам
+    struct Node {
+        vector<int> epsilon;
+        vector<pair<Range, int>> edges;
+    };
+
+    // Фрагмент автомата с одним входом и одним выходом
+    struct Fragment {
+        int start = 0;
+        int accept = 0;
+    };
+
+    static const int MAX_REPEAT = 1000;     // Наибольшая граница в {n,m}
+    static const size_t MAX_NODES = 1 << 20;  // Предел размера конструкции при повторах
+
+    string pattern;
+    size_t pos = 0;
+    string error;
+    vector<Node> nodes;
+
+    void fail(const string& message) {
+        if (error.empty()) {
+            error = message;
+        }
+    }
+
+    int node() {
+        nodes.emplace_back();
+        return nodes.size() - 1;
+    }
+
+    Fragment empty() {
+        int start = node(), accept = node();
+        nodes[start].epsilon.push_back(accept);
+        return {start, accept};
+    }
+
+    // <alternation> ::= <concatenation> ('|' <concatenation>)*
+    Fragment alternation() {
+        Fragment left = concatenation();
+        while (error.empty() && pos < pattern.size() && pattern[pos] == '|') {
+            pos++;
+            Fragment right = concatenation();
+            int start = node(), accept = node();
+            nodes[start].epsilon = {left.start, right.start};
+            nodes[left.accept].epsilon.push_back(accept);
+            nodes[right.accept].epsilon.push_back(accept);
+            left = {start, accept};
+        }
+        return left;
+    }
+
+    // <concatenation> ::= <repetition>*
+    Fragment concatenation() {
+        Fragment result = empty();
+        while (error.empty() && pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')') {
+            Fragment next = repetition();
+            nodes[result.accept].epsilon.push_back(next.start);
+            result.accept = next.accept;
+        }
+        return result;
+    }
+
+    // <repetition> ::= <atom> ('*' | '+' | '?' | '{' n [',' [m]] '}')*
+    // Узлы фрагмента занимают nodes[first..] подряд: так его можно копировать для {n,m}
+    Fragment repetition() {
+        size_t first = nodes.size();
+        Fragment inner = atom();
+        while (error.empty() && pos < pattern.size()) {
+            char op = pattern[pos];
+            if (op == '*' || op == '+' || op == '?') {
+                pos++;
+                inner = repeat(inner, op);
+                continue;
+            }
+            int low, high;
+            if (op != '{' || !parseBounds(low, high)) {
+                break;  // '{' не в виде границ повтора - обычный символ
+            }
+            inner = bounded(inner, first, low, high);
+        }
+        return inner;
+    }
+
+    Fragment repeat(Fragment inner, char op) {
+        int start = node(), accept = node();
+        nodes[start].epsilon.push_back(inner.start);
+        nodes[inner.accept].epsilon.push_back(accept);
+        if (op != '+') {
+            nodes[start].epsilon.push_back(accept);  // Ноль повторений
+        }
+        if (op != '?') {
+            nodes[inner.accept].epsilon.push_back(inner.start);  // Ещё одно повторение
+        }
+        return {start, accept};
+    }
+
+    // Границы {n}, {n,} или {n,m} начиная с '{'; false, если это не границы
+    bool parseBounds(int& low, int& high) {
+        size_t at = pos + 1;
+        auto number = [&](int& value) {
+            size_t begin = at;
+            value = 0;
+            while (at < pattern.size() && pattern[at] >= '0' && pattern[at] <= '9') {
+                value = min(value * 10 + (pattern[at++] - '0'), MAX_REPEAT + 1);
+            }
+            return at > begin;
+        };
+        if (!number(low)) {
+            return false;
+        }
+        high = low;
+        if (at < pattern.size() && pattern[at] == ',') {
+            at++;
+            if (!number(high)) {
+                high = -1;  // Без верхней границы
+            }
+        }
+        if (at >= pattern.size() || pattern[at] != '}') {
+            return false;
+        }
+        pos = at + 1;
+        if (low > MAX_REPEAT || high > MAX_REPEAT) {
+            fail("больше " + to_string(MAX_REPEAT) + " повторений");
+        } else if (high >= 0 && high < low) {
+            fail("границы повтора заданы в обратном порядке");
+        }
+        return true;
+    }
+
+    // Повтор от low до high раз (high < 0 - без ограничения): low обязательных
+    // копий фрагмента, затем необязательные или одна копия под '*'
+    Fragment bounded(Fragment inner, size_t first, int low, int high) {
+        if (!error.empty()) {
+            return inner;
+        }
+        int count = high < 0 ? max(low, 1) : high;
+        if ((nodes.size() - first) * count > MAX_NODES) {
+            fail("слишком много повторений");
+            return inner;
+        }
+        // Сначала все копии: repeat() меняет узлы копируемого фрагмента
+        size_t end = nodes.size();
+        vector<Fragment> pieces;
+        for (int i = 0; i < count; i++) {
+            pieces.push_back(i == 0 ? inner : copy(inner, first, end));
+        }
+        Fragment result = empty();
+        for (int i = 0; i < count; i++) {
+            Fragment piece = pieces[i];
+            if (high < 0 && i + 1 == count) {
+                piece = repeat(piece, low > i ? '+' : '*');
+            } else if (i >= low) {
+                piece = repeat(piece, '?');
+            }
+            nodes[result.accept].epsilon.push_back(piece.start);
+            result.accept = piece.accept;
+        }
+        return result;
+    }
+
+    // Копия фрагмента, чьи узлы - nodes[first, end)
+    Fragment copy(Fragment fragment, size_t first, size_t end) {
+        int offset = nodes.size() - first;
+        for (size_t i = first; i < end; i++) {
+            Node clone = nodes[i];
+            for (int& next : clone.epsilon) {
+                next += offset;
+            }
+            for (auto& edge : clone.edges) {
+                edge.second += offset;
+            }
+            nodes.push_back(std::move(clone));
+        }
+        return {fragment.start + offset, fragment.accept + offset};
+    }
+
+    // <atom> ::= '(' <alternation> ')' | <class> | '.' | '\' <символ> | <символ>
+    Fragment atom() {
+        char c = pattern[pos];
+        if (c == '(') {
+            pos++;
+            Fragment inner = alternation();
+            if (pos >= pattern.size() || pattern[pos] != ')') {
+                fail("ожидалась ')'");
+            } else {
+                pos++;
+            }
+            return inner;
+        }
+        int low, high;
+        if (c == '*' || c == '+' || c == '?' || (c == '{' && parseBounds(low, high))) {
+            fail(string("нечего повторять перед '") + c + "'");
+            return empty();
+        }
+
+        vector<Range> ranges;
+        if (c == '[') {
+            pos++;
+            parseClass(ranges);
+        } else if (c == '.') {
+            pos++;
+            ranges.push_back({0, 255});
+        } else if (c == '\\') {
+            pos++;
+            parseEscape(ranges);
+        } else {
+            pos++;
+            ranges.push_back({(unsigned char)c, (unsigned char)c});
+        }
+
+        int start = node(), accept = node();
+        for (const Range& range : normalize(ranges)) {
+            nodes[start].edges.push_back({range, accept});
+        }
+        return {start, accept};
+    }
+
+    // Символ после '\': классы \d \w \s, управляющие \n \t \r, остальное - сам символ
+    void parseEscape(vector<Range>& ranges) {
+        if (pos >= pattern.size()) {
+            fail("выражение оканчивается на '\\'");
+            return;
+        }
+        char c = pattern[pos++];
+        switch (c) {
+        case 'd': ranges.push_back({'0', '9'}); break;
+        case 'w': ranges.insert(ranges.end(), {{'0', '9'}, {'A', 'Z'}, {'a', 'z'}, {'_', '_'}}); break;
+        case 's': ranges.insert(ranges.end(), {{' ', ' '}, {'\t', '\r'}}); break;
+        case 'n': ranges.push_back({'\n', '\n'}); break;
+        case 't': ranges.push_back({'\t', '\t'}); break;
+        case 'r': ranges.push_back({'\r', '\r'}); break;
+        default: ranges.push_back({(unsigned char)c, (unsigned char)c}); break;
+        }
+    }
+
+    // Класс после '[': символы, диапазоны a-z и экранирование; '^' в начале - дополнение
+    void parseClass(vector<Range>& ranges) {
+        bool negated = pos < pattern.size() && pattern[pos] == '^';
+        if (negated) {
+            pos++;
+        }
+        vector<Range> members;
+        bool first = true;
+        while (pos < pattern.size() && (pattern[pos] != ']' || first)) {
+            first = false;
+            unsigned char low;
+            if (pattern[pos] == '\\') {
+                pos++;
+                size_t before = members.size();
+                parseEscape(members);
+                if (!error.empty() || members.size() != before + 1 || members.back().first != members.back().last) {
+                    continue;  // Класс вроде \d не может быть началом диапазона
+                }
+                low = members.back().first;
+                members.pop_back();
+            } else {
+                low = pattern[pos++];
+            }
+            unsigned char high = low;
+            if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') {
+                pos++;
+                high = pattern[pos++];
+                if (high == '\\' && pos < pattern.size()) {
+                    high = pattern[pos++];
+                }
+                if (high < low) {
+                    fail("диапазон в классе задан в обратном порядке");
+                    return;
+                }
+            }
+            members.push_back({low, high});
+        }
+        if (pos >= pattern.size()) {
+            fail("ожидалась ']'");
+            return;
+        }
+        pos++;
+
+        members = normalize(members);
+        if (!negated) {
+            ranges.insert(ranges.end(), members.begin(), members.end());
+            return;
+        }
+        int next = 0;
+        for (const Range& range : members) {
+            if (range.first > next) {
+                ranges.push_back({(unsigned char)next, (unsigned char)(range.first - 1)});
+            }
+            next = range.last + 1;
+        }
+        if (next <= 255) {
+            ranges.push_back({(unsigned char)next, 255});
+        }
+    }
+
+    // Сортировка и слияние пересекающихся и соседних диапазонов
+    static vector<Range> normalize(vector<Range> ranges) {
+        sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+        vector<Range> merged;
+        for (const Range& range : ranges) {
+            if (!merged.empty() && range.first <= merged.back().last + 1) {
+                merged.back().last = max(merged.back().last, range.last);
+            } else {
+                merged.push_back(range);
+            }
+        }
+        return merged;
+    }
+
+    // Перенос в FiniteAutomaton. Остаются только вход и узлы, в которые ведут
+    // переходы по символам; состояние конечное, если из него по ε достижим выход.
+    // Имена: q0 - начальное, остальные qN или fN для конечных, как в файлах автоматов
+    void build(const Fragment& whole, FiniteAutomaton& fa) {
+        vector<vector<int>> closures(nodes.size());
+        auto closure = [&](int from) -> const vector<int>& {
+            vector<int>& result = closures[from];
+            if (!result.empty()) {
+                return result;
+            }
+            vector<bool> seen(nodes.size());
+            vector<int> stack = {from};
+            seen[from] = true;
+            while (!stack.empty()) {
+                int current = stack.back();
+                stack.pop_back();
+                result.push_back(current);
+                for (int next : nodes[current].epsilon) {
+                    if (!seen[next]) {
+                        seen[next] = true;
+                        stack.push_back(next);
+                    }
+                }
+            }
+            return result;
+        };
+
+        vector<int> order;
+        map<int, State> states;
+        auto addState = [&](int at) {
+            const vector<int>& reachable = closure(at);
+            bool final = find(reachable.begin(), reachable.end(), whole.accept) != reachable.end();
+            string name = (final ? "f" : "q") + to_string(order.size());
+            State state(name, final);
+            states[at] = state;
+            order.push_back(at);
+            fa.addState(state);
+            if (final) {
+                fa.addFinalState(state);
+            }
+        };
+
+        addState(whole.start);
+        for (size_t i = 0; i < order.size(); i++) {
+            State from = states[order[i]];
+            map<int, vector<Range>> targets;
+            for (int member : closure(order[i])) {
+                for (const auto& edge : nodes[member].edges) {
+                    targets[edge.second].push_back(edge.first);
+                }
+            }
+            for (const auto& target : targets) {
+                if (!states.count(target.first)) {
+                    addState(target.first);
+                }
+                for (const Range& range : normalize(target.second)) {
+                    fa.addTransition(Transition(from, char(range.first), char(range.last), states[target.first]));
+                }
+            }
+        }
+        fa.setInitialState(states[whole.start]);
+    }
+};
+
+// Объединённый детерминированный автомат для нескольких шаблонов: строка
+// проходит через него один раз, а каждое состояние хранит номера шаблонов,
+// которые в нём принимают строку. Время разбора не растёт с числом шаблонов
+class UnionAutomaton {
+public:
+    // Построение подмножеств сразу для всех автоматов: начальное подмножество
+    // содержит начальные состояния каждого шаблона
+    explicit UnionAutomaton(const vector<FiniteAutomaton>& patterns) {
+        struct Edge {
+            unsigned char first, last;  // Диапазон байтов перехода
+            int to;
+        };
+        vector<vector<Edge>> edges;  // Переходы состояний всех шаблонов
+        vector<int> owner;                               // Номер шаблона для состояния
+        vector<bool> isFinal;
+        vector<int> initialStates;                       // Начальные состояния шаблонов
+
+        for (size_t id = 0; id < patterns.size(); id++) {
+            const FiniteAutomaton& pattern = patterns[id];
+            map<State, int> numbers;
+            auto number = [&](const State& state) {
+                auto inserted = numbers.emplace(state, edges.size());
+                if (inserted.second) {
+                    edges.emplace_back();
+                    owner.push_back(id);
+                    isFinal.push_back(pattern.finalStates.count(state) > 0);
+                }
+                return inserted.first->second;
+            };
+            initialStates.push_back(number(pattern.initialState));
+            for (const Transition& transition : pattern.transitions) {
+                int from = number(transition.from);
+                int to = number(transition.to);
+                edges[from].push_back({(unsigned char)transition.symbol, (unsigned char)transition.last, to});
+            }
+        }
+
+        map<vector<int>, int> subsets;
+        vector<vector<int>> pending;
+        auto addSubset = [&](vector<int> subset) {
+            sort(subset.begin(), subset.end());
+            subset.erase(unique(subset.begin(), subset.end()), subset.end());
+            auto found = subsets.find(subset);
+            if (found != subsets.end()) {
+                return found->second;
+            }
+            int index = accepts.size();
+            subsets[subset] = index;
+            table.resize(table.size() + 256, DEAD);
+            set<int> accepted;
+            for (int state : subset) {
+                if (isFinal[state]) {
+                    accepted.insert(owner[state]);
+                }
+            }
+            accepts.emplace_back(accepted.begin(), accepted.end());
+            pending.push_back(std::move(subset));
+            return index;
+        };
+
+        start = addSubset(initialStates);
+        for (size_t current = 0; current < pending.size(); current++) {
+            vector<vector<int>> next(256);
+            for (int state : pending[current]) {
+                for (const Edge& edge : edges[state]) {
+                    for (int symbol = edge.first; symbol <= edge.last; symbol++) {
+                        next[symbol].push_back(edge.to);
+                    }
+                }
+            }
+            for (int symbol = 0; symbol < 256; symbol++) {
+                if (!next[symbol].empty()) {
+                    int target = addSubset(std::move(next[symbol]));
+                    table[current * 256 + symbol] = target;
+                }
+            }
+        }
+        compressSymbols();
+    }
+
+    // Номера всех шаблонов, принимающих строку целиком
+    const vector<int>& match(const string& input) const {
+        static const vector<int> none;
+        int state = start;
+        for (unsigned char c : input) {
+            state = table[state * classCount + symbolClass[c]];
+            if (state == DEAD) {
+                return none;  // Дальше ни один шаблон строку не примет
+            }
+        }
+        return accepts[state];
+    }
+
+    size_t stateCount() const {
+        return accepts.size();
+    }
+
+    size_t tableBytes() const {
+        return table.size() * sizeof(table[0]);
+    }
+
+    // Счётчики посещений состояний и переходов (переход - ячейка таблицы)
+    struct Profile {
+        vector<uint64_t> stateHits;
+        vector<uint64_t> transitionHits;
+    };
+
+    Profile createProfile() const {
+        return {vector<uint64_t>(accepts.size()), vector<uint64_t>(table.size())};
+    }
+
+    // Разбор строки с подсчётом посещений
+    void profile(const string& input, Profile& counters) const {
+        int state = start;
+        counters.stateHits[state]++;
+        for (unsigned char c : input) {
+            int cell = state * classCount + symbolClass[c];
+            counters.transitionHits[cell]++;
+            state = table[cell];
+            if (state == DEAD) {
+                return;
+            }
+            counters.stateHits[state]++;
+        }
+    }
+
+    // Тепловая карта: самые посещаемые состояния и переходы
+    void printHeatmap(const Profile& counters, size_t limit, ostream& out) const {
+        uint64_t total = accumulate(counters.stateHits.begin(), counters.stateHits.end(), uint64_t(0));
+        vector<int> states(accepts.size());
+        iota(states.begin(), states.end(), 0);
+        sort(states.begin(), states.end(), [&](int a, int b) { return counters.stateHits[a] > counters.stateHits[b]; });
+
+        out << "Состояние\tПосещений\tДоля" << endl;
+        for (size_t i = 0; i < min(limit, states.size()) && counters.stateHits[states[i]] > 0; i++) {
+            uint64_t hits = counters.stateHits[states[i]];
+            out << states[i] << "\t" << hits << "\t" << string(total ? 40 * hits / total : 0, '#') << endl;
+        }
+
+        vector<size_t> cells;
+        for (size_t cell = 0; cell < table.size(); cell++) {
+            if (counters.transitionHits[cell] > 0) {
+                cells.push_back(cell);
+            }
+        }
+        sort(cells.begin(), cells.end(), [&](size_t a, size_t b) { return counters.transitionHits[a] > counters.transitionHits[b]; });
+        out << "Переход\tПроходов" << endl;
+        for (size_t i = 0; i < min(limit, cells.size()); i++) {
+            size_t cell = cells[i];
+            out << cell / classCount << ",'" << char(classSymbol[cell % classCount]) << "'=";
+            if (table[cell] == DEAD) {
+                out << "нет";
+            } else {
+                out << table[cell];
+            }
+            out << "\t" << counters.transitionHits[cell] << endl;
+        }
+        size_t visited = count_if(counters.stateHits.begin(), counters.stateHits.end(), [](uint64_t hits) { return hits > 0; });
+        out << "Посещено состояний: " << visited << " из " << accepts.size() << endl;
+    }
+
+    // Перенумерация по убыванию посещений: горячие строки таблицы оказываются
+    // рядом и занимают меньше строк кэша и страниц памяти
+    void reorder(const Profile& counters) {
+        vector<int> order(accepts.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return counters.stateHits[a] > counters.stateHits[b]; });
+        vector<int> renumbered(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            renumbered[order[i]] = i;
+        }
+
+        vector<int> newTable(table.size(), DEAD);
+        vector<vector<int>> newAccepts(accepts.size());
+        for (size_t state = 0; state < order.size(); state++) {
+            int row = renumbered[state] * classCount;
+            for (int column = 0; column < classCount; column++) {
+                int target = table[state * classCount + column];
+                newTable[row + column] = target == DEAD ? DEAD : renumbered[target];
+            }
+            newAccepts[renumbered[state]] = std::move(accepts[state]);
+        }
+        table = std::move(newTable);
+        accepts = std::move(newAccepts);
+        start = renumbered[start];
+    }
+
+private:
+    static constexpr int DEAD = -1;
+    vector<int> table;            // table[состояние * classCount + класс символа] - следующее состояние или DEAD
+    vector<vector<int>> accepts;  // Принимаемые шаблоны для каждого состояния
+    int start = 0;                // Начальное состояние
+    int classCount = 256;
+    vector<int> symbolClass = vector<int>(256);  // Класс каждого символа
+    vector<unsigned char> classSymbol;           // Первый символ класса, для вывода
+
+    // Символы с одинаковыми столбцами таблицы объединяются в один класс:
+    // строка состояния укорачивается, и соседние состояния делят строки кэша
+    void compressSymbols() {
+        size_t count = accepts.size();
+        map<vector<int>, int> columns;
+        classSymbol.clear();
+        for (int symbol = 0; symbol < 256; symbol++) {
+            vector<int> column(count);
+            for (size_t state = 0; state < count; state++) {
+                column[state] = table[state * 256 + symbol];
+            }
+            auto inserted = columns.emplace(std::move(column), columns.size());
+            if (inserted.second) {
+                classSymbol.push_back(symbol);
+            }
+            symbolClass[symbol] = inserted.first->second;
+        }
+
+        classCount = columns.size();
+        vector<int> compressed(count * classCount);
+        for (size_t state = 0; state < count; state++) {
+            for (int column = 0; column < classCount; column++) {
+                compressed[state * classCount + column] = table[state * 256 + classSymbol[column]];
+            }
+        }
+        table = std::move(compressed);
+    }
+};
+
 // Функция для удаления пробелов в начале и конце строки
 std::string trim(const std::string& str) {
     size_t first = str.find_first_not_of(' ');
@@ -202,21 +895,47 @@ std::string trim(const std::string& str) {
     return str.substr(first, last - first + 1);
 }
 
-// Основная функция программы
-int main() {
-    FiniteAutomaton fa;
-    cout << "Введите имя файла с автоматом: ";
-    string file;
-    getline(cin, file);
-    if (file.empty()) {
-        file = "1";
+// Символ метки перехода с позиции at: сам символ или код \xNN, как его
+// выводит Transition::label()
+bool parseLabelSymbol(const string& label, size_t& at, char& symbol) {
+    if (at >= label.size()) {
+        return false;
     }
+    auto hex = [](char c) {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    };
+    if (label[at] == '\\' && at + 3 < label.size() && label[at + 1] == 'x' && hex(label[at + 2]) >= 0 && hex(label[at + 3]) >= 0) {
+        symbol = char(hex(label[at + 2]) * 16 + hex(label[at + 3]));
+        at += 4;
+        return true;
+    }
+    symbol = label[at++];
+    return true;
+}
 
-    // Чтение файла с автоматом
-    ifstream fin(file + ".txt");
+// Метка перехода: a, \xNN или диапазон [a-z], [\x00-\xFF]. Нераспознанная
+// метка, как и раньше, означает переход по её первому символу
+void parseLabel(const string& label, char& symbol, char& last) {
+    size_t at = 0;
+    if (parseLabelSymbol(label, at, symbol) && at == label.size()) {
+        last = symbol;
+        return;
+    }
+    at = 1;
+    if (label.size() >= 5 && label[0] == '[' && parseLabelSymbol(label, at, symbol) && at < label.size() && label[at++] == '-'
+        && parseLabelSymbol(label, at, last) && at + 1 == label.size() && label[at] == ']') {
+        return;
+    }
+    symbol = last = label.empty() ? '\0' : label[0];
+}
+
+// Чтение автомата из файла в формате q0,a=q1 (конечные состояния начинаются с f).
+// Начальное состояние - q0, а если его нет, то f0
+bool readAutomaton(const string& filename, FiniteAutomaton& fa) {
+    ifstream fin(filename);
     if (!fin) {
-        cerr << "Ошибка открытия файла!" << endl;
-        return 1;
+        cerr << "Ошибка открытия файла " << filename << "!" << endl;
+        return false;
     }
 
     string line;
@@ -229,21 +948,418 @@ int main() {
         int lastEquals = line.find_last_of('=');
         int firstComma = line.find(',');
         string fromStateName = line.substr(0, firstComma);
-        char symbol = line[firstComma + 1];
+        char symbol, last;
+        parseLabel(line.substr(firstComma + 1, lastEquals - firstComma - 1), symbol, last);
         string toStateName = line.substr(lastEquals + 1);
-        bool isFinal = toStateName[0] == 'f';
 
-        State fromState(fromStateName, false);
-        State toState(toStateName, isFinal);
+        State fromState(fromStateName, fromStateName[0] == 'f');
+        State toState(toStateName, toStateName[0] == 'f');
 
         fa.addState(fromState);
         fa.addState(toState);
-        fa.addTransition(Transition(fromState, symbol, toState));
+        fa.addTransition(Transition(fromState, symbol, last, toState));
 
-        if (isFinal) {
+        if (fromState.isFinal) {
+            fa.addFinalState(fromState);
+        }
+        if (toState.isFinal) {
             fa.addFinalState(toState);
         }
     }
+    // Без q0 начальным считается f0: так --regex --print называет конечное начальное состояние
+    State acceptingStart("f0", true);
+    if (!fa.states.count(fa.initialState) && fa.states.count(acceptingStart)) {
+        fa.setInitialState(acceptingStart);
+    }
+    return true;
+}
+
+// Поиск по нескольким автоматам сразу: каждая строка входа проверяется
+// одним проходом объединённого автомата
+int runUnion(const vector<string>& files) {
+    vector<FiniteAutomaton> patterns(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!readAutomaton(files[i], patterns[i])) {
+            return 1;
+        }
+    }
+    UnionAutomaton automaton(patterns);
+    cout << "Шаблонов: " << patterns.size() << ", состояний объединённого автомата: " << automaton.stateCount() << endl;
+
+    string line;
+    while (getline(cin, line)) {
+        const vector<int>& matched = automaton.match(line);
+        cout << "\"" << line << "\": ";
+        if (matched.empty()) {
+            cout << "нет совпадений";
+        }
+        for (size_t i = 0; i < matched.size(); i++) {
+            cout << (i ? ", " : "") << files[matched[i]];
+        }
+        cout << endl;
+    }
+    return 0;
+}
+
+// Профилирование на обучающем корпусе: тепловая карта и перенумерация состояний
+int runProfile(const string& corpusFile, const vector<string>& files) {
+    vector<FiniteAutomaton> patterns(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!readAutomaton(files[i], patterns[i])) {
+            return 1;
+        }
+    }
+    ifstream corpus(corpusFile);
+    if (!corpus) {
+        cerr << "Ошибка открытия файла " << corpusFile << "!" << endl;
+        return 1;
+    }
+
+    UnionAutomaton automaton(patterns);
+    UnionAutomaton::Profile counters = automaton.createProfile();
+    string line;
+    while (getline(corpus, line)) {
+        automaton.profile(line, counters);
+    }
+    automaton.printHeatmap(counters, 20, cout);
+    return 0;
+}
+
+// Проверка строк из командной строки или, если их нет, из stdin
+int checkStrings(FiniteAutomaton fa, const vector<string>& strings) {
+    cout << "Автомат детерминирован? " << (fa.isDeterministic() ? "Да" : "Нет") << endl;
+    if (!fa.isDeterministic()) {
+        // Пустую строку автомат принимает, только если начальное состояние конечное;
+        // детерминизация не должна этого менять
+        bool acceptsEmpty = fa.finalStates.count(fa.initialState) > 0;
+        fa = fa.determinize();
+        if ((fa.finalStates.count(fa.initialState) > 0) != acceptsEmpty) {
+            cerr << "Ошибка детерминизации: автомат по-разному принимает пустую строку" << endl;
+            return 1;
+        }
+    }
+    auto check = [&](const string& input) {
+        bool accepted = fa.analyzeString(input);
+        cout << "\"" << input << "\": " << (accepted ? "Да" : "Нет") << endl;
+    };
+    if (!strings.empty()) {
+        for (const string& input : strings) {
+            check(input);
+        }
+        return 0;
+    }
+    string line;
+    while (getline(cin, line)) {
+        check(line);
+    }
+    return 0;
+}
+
+// Проверка строк без диалога: --check <файл автомата> [строки...],
+// без строк в командной строке они читаются из stdin
+int runCheck(const string& file, const vector<string>& strings) {
+    FiniteAutomaton fa;
+    if (!readAutomaton(file, fa)) {
+        return 1;
+    }
+    return checkStrings(fa, strings);
+}
+
+// Автомат по регулярному выражению: --regex <выражение> [строки...].
+// С --print вместо проверки выводятся переходы в формате файла автомата
+int runRegex(const string& pattern, const vector<string>& strings, bool print) {
+    FiniteAutomaton fa;
+    RegexCompiler compiler;
+    if (!compiler.compile(pattern, fa)) {
+        return 1;
+    }
+    if (print) {
+        for (const Transition& transition : fa.transitions) {
+            cout << transition.from.name << "," << transition.label() << "=" << transition.to.name << endl;
+        }
+        return 0;
+    }
+    size_t symbols = 0;
+    for (const Transition& transition : fa.transitions) {
+        symbols += (unsigned char)transition.last - (unsigned char)transition.symbol + 1;
+    }
+    cout << "Состояний: " << fa.states.size() << ", переходов: " << fa.transitions.size()
+         << " (по одному на символ было бы " << symbols << ")" << endl;
+    return checkStrings(fa, strings);
+}
+
+string randomWord(mt19937& random) {
+    string word(3 + random() % 10, ' ');
+    for (char& c : word) {
+        c = 'a' + random() % 26;
+    }
+    return word;
+}
+
+// Словарь случайных слов и автомат-цепочка q0 -> q1 -> ... -> f для каждого
+vector<FiniteAutomaton> generateWordPatterns(size_t wordCount, mt19937& random, vector<string>& words) {
+    words.resize(wordCount);
+    vector<FiniteAutomaton> patterns(wordCount);
+    for (size_t i = 0; i < wordCount; i++) {
+        words[i] = randomWord(random);
+        for (size_t j = 0; j < words[i].size(); j++) {
+            State from("q" + to_string(j), false);
+            State to(j + 1 == words[i].size() ? "f" : "q" + to_string(j + 1), j + 1 == words[i].size());
+            patterns[i].addTransition(Transition(from, words[i][j], to));
+            if (to.isFinal) {
+                patterns[i].addFinalState(to);
+            }
+        }
+    }
+    return patterns;
+}
+
+// Неравномерный вход: 90% строк - из 1% слов, остальное - любые слова словаря и случайные строки
+vector<string> generateInputs(const vector<string>& words, size_t inputCount, mt19937& random) {
+    vector<string> inputs(inputCount);
+    size_t hotCount = max<size_t>(words.size() / 100, 1);
+    for (string& input : inputs) {
+        size_t kind = random() % 10;
+        if (kind < 9) {
+            input = words[random() % hotCount];
+        } else {
+            input = kind == 9 && random() % 2 ? words[random() % words.size()] : randomWord(random);
+        }
+    }
+    return inputs;
+}
+
+// Сравнение исходной и перенумерованной таблицы на большом автомате
+// (словарь случайных слов) и неравномерном входе
+int runReorderBenchmark(size_t wordCount, size_t inputCount) {
+    mt19937 random(42);
+    vector<string> words;
+    vector<FiniteAutomaton> patterns = generateWordPatterns(wordCount, random, words);
+    vector<string> inputs = generateInputs(words, inputCount, random);
+
+    UnionAutomaton automaton(patterns);
+    auto measure = [&]() {
+        const int repeats = 5;
+        double best = 1e300;
+        size_t matched = 0;
+        for (int repeat = 0; repeat < repeats; repeat++) {
+            matched = 0;
+            auto start = chrono::steady_clock::now();
+            for (const string& input : inputs) {
+                matched += automaton.match(input).size();
+            }
+            best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+        return make_pair(best, matched);
+    };
+
+    cout << "Слов: " << wordCount << ", состояний: " << automaton.stateCount()
+         << ", таблица: " << automaton.tableBytes() / 1048576.0 << " МБ, строк входа: " << inputCount << endl;
+    auto before = measure();
+
+    UnionAutomaton::Profile counters = automaton.createProfile();
+    for (size_t i = 0; i < inputs.size(); i += 10) {
+        automaton.profile(inputs[i], counters);  // Обучение на каждой десятой строке
+    }
+    automaton.reorder(counters);
+    auto after = measure();
+
+    cout << "Исходная нумерация, мс\tПосле перенумерации, мс\tУскорение" << endl;
+    cout << before.first << "\t" << after.first << "\t" << before.first / after.first << endl;
+    if (before.second != after.second) {
+        cerr << "Результаты разбора различаются!" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+#ifdef LAB_BENCHMARK
+// Задержки построения и поиска на сгенерированных словарях
+int runLatencyBenchmark(double scale) {
+    const size_t batch = 256;  // Строк входа на одну операцию поиска
+    mt19937 random(42);
+    vector<string> words;
+    vector<FiniteAutomaton> patterns = generateWordPatterns(2000, random, words);
+    vector<string> inputs = generateInputs(words, 100000, random);
+    size_t batchBytes = 0;
+    for (size_t i = 0; i < batch; i++) {
+        batchBytes += inputs[i].size();
+    }
+
+    // Недетерминированный автомат: слова из общего начального состояния
+    vector<string> nfaWords(words.begin(), words.begin() + 40);
+    FiniteAutomaton nfa;
+    for (size_t i = 0; i < nfaWords.size(); i++) {
+        for (size_t j = 0; j < nfaWords[i].size(); j++) {
+            State from(j == 0 ? "q0" : "w" + to_string(i) + "_" + to_string(j), false);
+            bool last = j + 1 == nfaWords[i].size();
+            State to(last ? "f" + to_string(i) : "w" + to_string(i) + "_" + to_string(j + 1), last);
+            nfa.addTransition(Transition(from, nfaWords[i][j], to));
+            if (last) {
+                nfa.addFinalState(to);
+            }
+        }
+    }
+    FiniteAutomaton dfa = nfa.determinize();
+    size_t nfaBytes = 0;
+    for (const string& word : nfaWords) {
+        nfaBytes += word.size();
+    }
+
+    // Одно выражение в двух видах: переходы-диапазоны из RegexCompiler и
+    // переход на каждый символ, как в файлах автоматов
+    const string regex = "[a-z]*a[a-z]{3}";
+    FiniteAutomaton ranged;
+    RegexCompiler().compile(regex, ranged);
+    FiniteAutomaton perSymbol;
+    perSymbol.states = ranged.states;
+    perSymbol.finalStates = ranged.finalStates;
+    perSymbol.setInitialState(ranged.initialState);
+    for (const Transition& transition : ranged.transitions) {
+        for (int c = (unsigned char)transition.symbol; c <= (unsigned char)transition.last; c++) {
+            perSymbol.addTransition(Transition(transition.from, char(c), transition.to));
+        }
+    }
+    FiniteAutomaton rangedDfa = ranged.determinize(), perSymbolDfa = perSymbol.determinize();
+    vector<string> regexInputs(64);
+    for (string& input : regexInputs) {
+        input = randomWord(random) + "a" + randomWord(random).substr(0, 3);
+    }
+    size_t regexBytes = 0;
+    for (const string& input : regexInputs) {
+        regexBytes += input.size();
+    }
+    auto analyzeAll = [&](const FiniteAutomaton& dfa) {
+        size_t accepted = 0;
+        for (const string& input : regexInputs) {
+            accepted += dfa.analyzeString(input);
+        }
+        return accepted;
+    };
+
+    // Повтор {3} должен давать тот же язык, что и три копии [a-z] подряд.
+    // Строки только из a-z: из любого состояния этих автоматов по ним есть переход,
+    // поэтому analyzeString ничего не печатает
+    FiniteAutomaton expanded;
+    RegexCompiler().compile("[a-z]*a[a-z][a-z][a-z]", expanded);
+    expanded = expanded.determinize();
+    for (int i = 0; i < 1000; i++) {
+        string input = randomWord(random).substr(0, random() % 8);
+        for (char& c : input) {
+            c = "abz"[random() % 3];
+        }
+        if (rangedDfa.analyzeString(input) != expanded.analyzeString(input)) {
+            cerr << regex << ": расходится с развёрнутым выражением на строке \"" << input << "\"" << endl;
+            return 1;
+        }
+    }
+
+    vector<FiniteAutomaton> small(patterns.begin(), patterns.begin() + 200);
+    UnionAutomaton automaton(patterns);
+    UnionAutomaton::Profile counters = automaton.createProfile();
+    for (size_t i = 0; i < inputs.size(); i += 10) {
+        automaton.profile(inputs[i], counters);
+    }
+    UnionAutomaton reordered = automaton;
+    reordered.reorder(counters);
+
+    // Операция поиска: batch строк подряд, от операции к операции окно сдвигается
+    auto matchBatch = [&](const UnionAutomaton& target, size_t i) {
+        size_t matched = 0;
+        size_t first = i * batch % (inputs.size() - batch);
+        for (size_t j = first; j < first + batch; j++) {
+            matched += target.match(inputs[j]).size();
+        }
+        return matched;
+    };
+
+    cout << "Слов: " << words.size() << ", состояний объединённого автомата: " << automaton.stateCount()
+         << ", строк на операцию поиска: " << batch << endl;
+    cout << regex << ": переходов " << ranged.transitions.size() << " против " << perSymbol.transitions.size()
+         << ", после детерминизации " << rangedDfa.transitions.size() << " против " << perSymbolDfa.transitions.size() << endl;
+    printLatencyHeader(cout);
+    printLatency(cout, "determinize (40 слов)", measureLatency(scaled(20, scale), 0, [&](size_t) {
+        return nfa.determinize().transitions.size();
+    }));
+    // analyzeString печатает отказы, поэтому на вход идут только слова автомата
+    printLatency(cout, "analyzeString (40 слов)", measureLatency(scaled(2000, scale), nfaBytes, [&](size_t) {
+        size_t accepted = 0;
+        for (const string& word : nfaWords) {
+            accepted += dfa.analyzeString(word);
+        }
+        return accepted;
+    }));
+    printLatency(cout, "RegexCompiler", measureLatency(scaled(5000, scale), regex.size(), [&](size_t) {
+        FiniteAutomaton fa;
+        RegexCompiler().compile(regex, fa);
+        return fa.transitions.size();
+    }));
+    printLatency(cout, "determinize, диапазоны", measureLatency(scaled(200, scale), 0, [&](size_t) {
+        return ranged.determinize().transitions.size();
+    }));
+    printLatency(cout, "determinize, по символу", measureLatency(scaled(20, scale), 0, [&](size_t) {
+        return perSymbol.determinize().transitions.size();
+    }));
+    printLatency(cout, "analyzeString, диапазоны", measureLatency(scaled(500, scale), regexBytes, [&](size_t) {
+        return analyzeAll(rangedDfa);
+    }));
+    printLatency(cout, "analyzeString, по символу", measureLatency(scaled(50, scale), regexBytes, [&](size_t) {
+        return analyzeAll(perSymbolDfa);
+    }));
+    printLatency(cout, "UnionAutomaton (200 слов)", measureLatency(scaled(50, scale), 0, [&](size_t) {
+        return UnionAutomaton(small).stateCount();
+    }));
+    printLatency(cout, "match", measureLatency(scaled(20000, scale), batchBytes, [&](size_t i) { return matchBatch(automaton, i); }));
+    printLatency(cout, "match после reorder", measureLatency(scaled(20000, scale), batchBytes, [&](size_t i) { return matchBatch(reordered, i); }));
+    return 0;
+}
+
+// Исполняемый файл lab_2_bench: вместо диалога - замеры, lab_2_bench [множитель объёма]
+int main(int argc, char* argv[]) {
+    return runLatencyBenchmark(benchScale(argc, argv));
+}
+#else
+// Основная функция программы
+int main(int argc, char* argv[]) {
+    // Проверка строк без диалога: --check <файл автомата> [строки...]
+    if (argc >= 3 && string(argv[1]) == "--check") {
+        return runCheck(argv[2], vector<string>(argv + 3, argv + argc));
+    }
+    // Автомат по регулярному выражению: --regex [--print] <выражение> [строки...]
+    if (argc >= 3 && string(argv[1]) == "--regex") {
+        bool print = string(argv[2]) == "--print";
+        if (print && argc < 4) {
+            cerr << "Не задано регулярное выражение" << endl;
+            return 1;
+        }
+        int first = print ? 3 : 2;
+        return runRegex(argv[first], vector<string>(argv + first + 1, argv + argc), print);
+    }
+    // Профиль: --profile <корпус> <файлы автоматов...>
+    if (argc >= 4 && string(argv[1]) == "--profile") {
+        return runProfile(argv[2], vector<string>(argv + 3, argv + argc));
+    }
+    // Замер перенумерации: --bench-reorder [слов] [строк входа]
+    if (argc >= 2 && string(argv[1]) == "--bench-reorder") {
+        return runReorderBenchmark(argc >= 3 ? atoi(argv[2]) : 20000, argc >= 4 ? atoi(argv[3]) : 2000000);
+    }
+    // Объединённый поиск: --union <файлы автоматов...>, строки читаются из stdin
+    if (argc >= 3 && string(argv[1]) == "--union") {
+        return runUnion(vector<string>(argv + 2, argv + argc));
+    }
+
+    FiniteAutomaton fa;
+    cout << "Введите имя файла с автоматом: ";
+    string file;
+    getline(cin, file);
+    if (file.empty()) {
+        file = "1";
+    }
+
+    // Чтение файла с автоматом
+    if (!readAutomaton(file + ".txt", fa)) {
+        return 1;
+    }
 
     // Проверка, является ли автомат детерминированным
     cout << "Автомат детерминирован? " << (fa.isDeterministic() ? "Да" : "Нет") << endl;
@@ -253,7 +1369,7 @@ int main() {
         FiniteAutomaton deterministicFA = fa.determinize();
         cout << "Переходы детерминированного автомата:" << endl;
         for (const Transition& transition : deterministicFA.transitions) {
-            cout << transition.from.name << "," << transition.symbol << "=" << transition.to.name << endl;
+            cout << transition.from.name << "," << transition.label() << "=" << transition.to.name << endl;
         }
         fa = deterministicFA;
     }
@@ -267,3 +1383,4 @@ int main() {
 
     return 0;
 }
+#endif
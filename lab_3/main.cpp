@@ -6,6 +6,21 @@
 #include <map>
 #include <set>
 #include <regex>
+#include <random>
+#include <chrono>
+
+#if defined(LAB3_GENERATED_HEADER)
+#include LAB3_GENERATED_HEADER // Тот же заголовок, сгенерированный при сборке CMake
+#elif !defined(LAB3_NO_GENERATED)
+#include "recognizers.h" // Распознаватели, сгенерированные режимом --generate
+#endif
+
+#ifdef LAB_BENCHMARK
+#ifdef LAB3_NO_GENERATED
+#error "Замерам нужны сгенерированные распознаватели"
+#endif
+#include "../bench/bench.h"
+#endif
 
 using namespace std;
 
@@ -233,8 +248,8 @@ public:
 		}
 	}
 
-	// Метод для проверки входной строки
-	bool checkInputLine(const string& str)
+	// Запуск автомата на строке; цепочка переходов остаётся для вывода
+	bool runChain(const string& str)
 	{
 		// Инициализация перехода с входной строкой
 		if (commands[0].values.size() == 1)
@@ -245,7 +260,21 @@ public:
 		transitionChain[0].stack.push_back(commands[0].args.stackSymbol); // Начальное состояние стека
 
 		// Запуск проверки переходов
-		bool result = pushTransition();
+		return pushTransition();
+	}
+
+	// Проверка строки без вывода
+	bool accepts(const string& str)
+	{
+		bool result = runChain(str);
+		transitionChain.clear();
+		return result;
+	}
+
+	// Метод для проверки входной строки
+	bool checkInputLine(const string& str)
+	{
+		bool result = runChain(str);
 		if (result)
 		{
 			cout << "Валидная строка\n"; // Если строка валидна
@@ -258,30 +287,289 @@ public:
 		return result;
 	}
 
+	// Случайный вывод из грамматики не длиннее maxLength (пустая строка, если не удалось)
+	string sample(mt19937& random, size_t maxLength)
+	{
+		string stack(1, commands[0].args.stackSymbol), result;
+		while (!stack.empty())
+		{
+			if (result.size() + stack.size() > maxLength)
+				return "";
+			char top = stack.back();
+			stack.pop_back();
+			if (!nonTerminalSymbols.count(top))
+			{
+				result.push_back(top);
+				continue;
+			}
+			vector<const string*> alternatives;
+			for (const auto& cmd : commands)
+				if (cmd.args.inputSymbol == emptySymbol && cmd.args.stackSymbol == top)
+					for (const StackValue& v : cmd.values)
+						alternatives.push_back(&v.content);
+			stack += *alternatives[random() % alternatives.size()]; // Содержимое уже перевёрнуто
+		}
+		return result;
+	}
+
+	// Генерация распознавателя на C++. Для каждого символа вершины стека своя ветка
+	// switch, альтернативы правил становятся вызовами шаблона expand с символами
+	// в параметрах. Порядок перебора и отсечение по длине те же, что в pushTransition
+	void generateRecognizer(ostream& out, const string& name)
+	{
+		vector<char> symbols; // Символы стека в порядке первого появления в командах
+		for (const auto& cmd : commands)
+			if (find(symbols.begin(), symbols.end(), cmd.args.stackSymbol) == symbols.end())
+				symbols.push_back(cmd.args.stackSymbol);
+
+		out << "namespace " << name << "\n{\n";
+		out << "\tinline bool step(const char* input, int pos, int length, char* stack, int depth)\n\t{\n";
+		out << "\t\tif (pos >= length || depth == 0)\n\t\t\treturn false;\n";
+		out << "\t\tOutcome outcome;\n";
+		out << "\t\tswitch (stack[depth - 1])\n\t\t{\n";
+		for (char symbol : symbols)
+		{
+			out << "\t\tcase " << charLiteral(symbol) << ":\n";
+			for (const auto& cmd : commands)
+			{
+				if (cmd.args.stackSymbol != symbol)
+					continue;
+				bool terminal = cmd.args.inputSymbol != emptySymbol;
+				string indent = terminal ? "\t\t\t\t" : "\t\t\t";
+				if (terminal)
+					out << "\t\t\tif (input[pos] == " << charLiteral(cmd.args.inputSymbol) << ")\n\t\t\t{\n";
+				for (const StackValue& v : cmd.values)
+				{
+					out << indent << "outcome = expand<step";
+					for (char c : v.content)
+						out << ", " << charLiteral(c);
+					out << ">(input, pos" << (terminal ? " + 1" : "") << ", length, stack, depth);\n";
+					out << indent << "if (outcome != FAILED)\n" << indent << "\treturn outcome == FOUND;\n";
+				}
+				if (terminal)
+					out << "\t\t\t}\n";
+			}
+			out << "\t\t\treturn false;\n";
+		}
+		out << "\t\tdefault:\n\t\t\treturn false;\n\t\t}\n\t}\n\n";
+
+		out << "\tinline bool recognize(const std::string& line)\n\t{\n";
+		out << "\t\tchar local[64];\n\t\tstd::vector<char> heap;\n";
+		out << "\t\tchar* stack = line.size() < sizeof(local) ? local : (heap.resize(line.size() + 1), heap.data());\n";
+		out << "\t\tstack[0] = " << charLiteral(commands[0].args.stackSymbol) << ";\n";
+		out << "\t\treturn step(line.data(), 0, line.size(), stack, 1);\n\t}\n";
+		out << "}\n\n";
+	}
+
 	~AutomatonStorage() 
 	{ 
 		file.close(); 
 	}
+
+private:
+	static string charLiteral(char c)
+	{
+		if (c == '\'' || c == '\\')
+			return string("'\\") + c + "'";
+		if (c < ' ' || c > '~')
+			return "char(" + to_string(int(c)) + ")";
+		return string("'") + c + "'";
+	}
 };
 
+// Заголовок с распознавателями для всех грамматик: общий шаблон expand и по
+// пространству имён на грамматику
+void generateRecognizers(const vector<string>& files)
+{
+	cout << "// Сгенерировано: ./prog --generate";
+	for (const auto& file : files)
+		cout << " " << file;
+	cout << " > recognizers.h\n// Не редактировать вручную\n\n";
+	cout << "#pragma once\n\n#include <string>\n#include <vector>\n\nnamespace generated\n{\n";
+	cout << "enum Outcome { FOUND, FAILED, PRUNED };\n\n";
+	cout << "// Замена вершины стека символами Symbols (уже перевёрнутыми) и продолжение разбора.\n";
+	cout << "// PRUNED: оставшийся вход короче стека, перебор на этом уровне прекращается\n";
+	cout << "template <bool (*Step)(const char*, int, int, char*, int), char... Symbols>\n";
+	cout << "inline Outcome expand(const char* input, int pos, int length, char* stack, int depth)\n{\n";
+	cout << "\tint newDepth = depth - 1 + sizeof...(Symbols);\n";
+	cout << "\tif (length - pos < newDepth)\n\t\treturn PRUNED;\n";
+	cout << "\tchar top = stack[depth - 1];\n\tint i = depth - 1;\n";
+	cout << "\t((stack[i++] = Symbols), ...);\n";
+	cout << "\tbool found = (pos == length && newDepth == 0) || Step(input, pos, length, stack, newDepth);\n";
+	cout << "\tstack[depth - 1] = top;\n\treturn found ? FOUND : FAILED;\n}\n\n";
+
+	vector<string> names;
+	for (const auto& file : files)
+	{
+		string name = file.substr(0, file.find('.'));
+		AutomatonStorage(file.c_str()).generateRecognizer(cout, name);
+		names.push_back(name);
+	}
+
+	cout << "struct Recognizer\n{\n\tconst char* grammar;\n\tbool (*recognize)(const std::string&);\n};\n\n";
+	cout << "const Recognizer recognizers[] = {\n";
+	for (size_t i = 0; i < files.size(); i++)
+		cout << "\t{\"" << files[i] << "\", " << names[i] << "::recognize},\n";
+	cout << "};\n}\n";
+}
+
+// Проверка строк без диалога: --check <файл грамматики> [строки...],
+// без строк в командной строке они читаются из stdin
+int runCheck(const string& file, const vector<string>& lines)
+{
+	AutomatonStorage storage(file.c_str());
+	auto check = [&](const string& line)
+	{
+		cout << "\"" << line << "\": " << (storage.accepts(line) ? "Валидная строка" : "Невалидная строка") << "\n";
+	};
+	if (!lines.empty())
+	{
+		for (const auto& line : lines)
+			check(line);
+		return 0;
+	}
+	for (string line; getline(cin, line);)
+		check(line);
+	return 0;
+}
+
+#ifndef LAB3_NO_GENERATED
+// Строки inputs.txt и случайные выводы из грамматики (с испорченными копиями
+// для отрицательных примеров); false, если интерпретатор и сгенерированный
+// код расходятся хотя бы на одной строке
+bool benchmarkInputs(AutomatonStorage& storage, const generated::Recognizer& recognizer, mt19937& random, vector<string>& inputs)
+{
+	ifstream inputFile("inputs.txt");
+	for (string line; getline(inputFile, line);)
+		inputs.push_back(line);
+	for (int i = 0; i < 300; i++)
+	{
+		string line = storage.sample(random, 12);
+		if (line.empty())
+			continue;
+		inputs.push_back(line);
+		line[random() % line.size()] = "ab0/-9x"[random() % 7];
+		inputs.push_back(line);
+	}
+
+	for (const auto& line : inputs)
+	{
+		if (storage.accepts(line) != recognizer.recognize(line))
+		{
+			cerr << recognizer.grammar << ": результаты различаются на строке \"" << line << "\"\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+// Сравнение интерпретатора и сгенерированного кода
+int runBenchmark(int repeats)
+{
+	mt19937 random(42);
+	cout << "Грамматика\tСтрок\tИнтерпретатор, мс\tКод, мс\tУскорение\n";
+	for (const auto& recognizer : generated::recognizers)
+	{
+		AutomatonStorage storage(recognizer.grammar);
+		vector<string> inputs;
+		if (!benchmarkInputs(storage, recognizer, random, inputs))
+			return 1;
+
+		double best[2] = { 1e300, 1e300 };
+		size_t accepted[2] = { 0, 0 };
+		for (int repeat = 0; repeat < repeats; repeat++)
+		{
+			for (int mode = 0; mode < 2; mode++)
+			{
+				accepted[mode] = 0;
+				auto start = chrono::steady_clock::now();
+				for (const auto& line : inputs)
+					accepted[mode] += mode == 0 ? storage.accepts(line) : recognizer.recognize(line);
+				double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+				best[mode] = min(best[mode], elapsed);
+			}
+		}
+		cout << recognizer.grammar << "\t" << inputs.size() << "\t" << best[0] << "\t" << best[1] << "\t" << best[0] / best[1] << "\n";
+	}
+	return 0;
+}
+#endif
+
+#ifdef LAB_BENCHMARK
+// Задержка проверки одной строки интерпретатором и сгенерированным кодом
+int runLatencyBenchmark(double scale)
+{
+	mt19937 random(42);
+	printLatencyHeader(cout);
+	for (const auto& recognizer : generated::recognizers)
+	{
+		AutomatonStorage storage(recognizer.grammar);
+		vector<string> inputs;
+		if (!benchmarkInputs(storage, recognizer, random, inputs))
+			return 1;
+		size_t bytes = 0;
+		for (const auto& line : inputs)
+			bytes += line.size();
+		bytes /= inputs.size();
+
+		string name = recognizer.grammar;
+		printLatency(cout, name + " интерпретатор", measureLatency(scaled(20000, scale), bytes, [&](size_t i)
+		{
+			return size_t(storage.accepts(inputs[i % inputs.size()]));
+		}));
+		printLatency(cout, name + " код", measureLatency(scaled(200000, scale), bytes, [&](size_t i)
+		{
+			return size_t(recognizer.recognize(inputs[i % inputs.size()]));
+		}));
+	}
+	return 0;
+}
+
+// Исполняемый файл lab_3_bench: вместо диалога - замеры, lab_3_bench [множитель объёма].
+// Файлы грамматик и inputs.txt ищутся в текущем каталоге
+int main(int argc, char* argv[])
+{
+	try {
+		return runLatencyBenchmark(benchScale(argc, argv));
+	}
+	catch (const exception& err) {
+		cerr << err.what() << endl;
+		return 1;
+	}
+}
+#else
 // Главная функция программы
 int main(int argc, char* argv[]) 
 {
 	setlocale(LC_ALL, "Russian");
 	string inputLine;
 	try {
+		// Генерация распознавателей: --generate grammar1.txt ... > recognizers.h
+		if (argc >= 3 && string(argv[1]) == "--generate")
+		{
+			generateRecognizers(vector<string>(argv + 2, argv + argc));
+			return 0;
+		}
+#ifndef LAB3_NO_GENERATED
+		// Сравнение с интерпретатором: --bench [повторов]
+		if (argc >= 2 && string(argv[1]) == "--bench")
+			return runBenchmark(argc >= 3 ? atoi(argv[2]) : 5);
+#endif
+		// Проверка строк без диалога: --check <файл грамматики> [строки...]
+		if (argc >= 3 && string(argv[1]) == "--check")
+			return runCheck(argv[2], vector<string>(argv + 3, argv + argc));
+
 	    string file = "1";
 	    cout << "Грамматика: ";
 	    getline(cin, file);
 		AutomatonStorage storage(("grammar" + file + ".txt").c_str()); // Создаем экземпляр автомата
 		storage.displayInfo(); // Отображаем информацию о грамматике
 
-		while (true)
+		cout << "Введите строку: \n";
+		while (getline(cin, inputLine)) // До конца ввода
 		{
-			cout << "Введите строку: \n";
-			getline(cin, inputLine);
 			storage.checkInputLine(inputLine); // Проверяем строку
-			cout << endl;
+			cout << endl << "Введите строку: \n";
 		}
 	}
 	catch (const exception& err) {
@@ -289,3 +577,4 @@ int main(int argc, char* argv[])
 	}
 	return 0;
 }
+#endif
@@ -0,0 +1,474 @@
+// Сгенерировано: ./prog --generate grammar1.txt grammar2.txt grammar3.txt > recognizers.h
+// Не редактировать вручную
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace generated
+{
+enum Outcome { FOUND, FAILED, PRUNED };
+
+// Замена вершины стека символами Symbols (уже перевёрнутыми) и продолжение разбора.
+// PRUNED: оставшийся вход короче стека, перебор на этом уровне прекращается
+template <bool (*Step)(const char*, int, int, char*, int), char... Symbols>
+inline Outcome expand(const char* input, int pos, int length, char* stack, int depth)
+{
+	int newDepth = depth - 1 + sizeof...(Symbols);
+	if (length - pos < newDepth)
+		return PRUNED;
+	char top = stack[depth - 1];
+	int i = depth - 1;
+	((stack[i++] = Symbols), ...);
+	bool found = (pos == length && newDepth == 0) || Step(input, pos, length, stack, newDepth);
+	stack[depth - 1] = top;
+	return found ? FOUND : FAILED;
+}
+
+namespace grammar1
+{
+	inline bool step(const char* input, int pos, int length, char* stack, int depth)
+	{
+		if (pos >= length || depth == 0)
+			return false;
+		Outcome outcome;
+		switch (stack[depth - 1])
+		{
+		case 'E':
+			outcome = expand<step, 'T', 'm'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'T', '!'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'T'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'T':
+			outcome = expand<step, '/', 'P', '/'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'P':
+			outcome = expand<step, 'R'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'S'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'R':
+			outcome = expand<step, 'C', '-', 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'C':
+			outcome = expand<step, 'a'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'b'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'c'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '0'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '>'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'S':
+			outcome = expand<step, 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'S', 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case '!':
+			if (input[pos] == '!')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '-':
+			if (input[pos] == '-')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '/':
+			if (input[pos] == '/')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '0':
+			if (input[pos] == '0')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '>':
+			if (input[pos] == '>')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'a':
+			if (input[pos] == 'a')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'b':
+			if (input[pos] == 'b')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'c':
+			if (input[pos] == 'c')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'm':
+			if (input[pos] == 'm')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '|':
+			outcome = expand<step>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		default:
+			return false;
+		}
+	}
+
+	inline bool recognize(const std::string& line)
+	{
+		char local[64];
+		std::vector<char> heap;
+		char* stack = line.size() < sizeof(local) ? local : (heap.resize(line.size() + 1), heap.data());
+		stack[0] = 'E';
+		return step(line.data(), 0, line.size(), stack, 1);
+	}
+}
+
+namespace grammar2
+{
+	inline bool step(const char* input, int pos, int length, char* stack, int depth)
+	{
+		if (pos >= length || depth == 0)
+			return false;
+		Outcome outcome;
+		switch (stack[depth - 1])
+		{
+		case 'E':
+			outcome = expand<step, 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'S', 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'C':
+			outcome = expand<step, 'a'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'b'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'x'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'y'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'S':
+			outcome = expand<step, 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'D'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'S', 'C'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'S', 'D'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'D':
+			outcome = expand<step, '0'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '1'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '2'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '3'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '4'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '5'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '6'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '7'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '8'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, '9'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case '0':
+			if (input[pos] == '0')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '1':
+			if (input[pos] == '1')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '2':
+			if (input[pos] == '2')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '3':
+			if (input[pos] == '3')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '4':
+			if (input[pos] == '4')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '5':
+			if (input[pos] == '5')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '6':
+			if (input[pos] == '6')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '7':
+			if (input[pos] == '7')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '8':
+			if (input[pos] == '8')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '9':
+			if (input[pos] == '9')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'a':
+			if (input[pos] == 'a')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'b':
+			if (input[pos] == 'b')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'x':
+			if (input[pos] == 'x')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'y':
+			if (input[pos] == 'y')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '|':
+			outcome = expand<step>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		default:
+			return false;
+		}
+	}
+
+	inline bool recognize(const std::string& line)
+	{
+		char local[64];
+		std::vector<char> heap;
+		char* stack = line.size() < sizeof(local) ? local : (heap.resize(line.size() + 1), heap.data());
+		stack[0] = 'E';
+		return step(line.data(), 0, line.size(), stack, 1);
+	}
+}
+
+namespace grammar3
+{
+	inline bool step(const char* input, int pos, int length, char* stack, int depth)
+	{
+		if (pos >= length || depth == 0)
+			return false;
+		Outcome outcome;
+		switch (stack[depth - 1])
+		{
+		case 'E':
+			outcome = expand<step, 'a'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'a', 'S'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'S', 'b'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'S':
+			outcome = expand<step, 'a'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'b'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'a', 'S'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			outcome = expand<step, 'b', 'S'>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		case 'a':
+			if (input[pos] == 'a')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case 'b':
+			if (input[pos] == 'b')
+			{
+				outcome = expand<step>(input, pos + 1, length, stack, depth);
+				if (outcome != FAILED)
+					return outcome == FOUND;
+			}
+			return false;
+		case '|':
+			outcome = expand<step>(input, pos, length, stack, depth);
+			if (outcome != FAILED)
+				return outcome == FOUND;
+			return false;
+		default:
+			return false;
+		}
+	}
+
+	inline bool recognize(const std::string& line)
+	{
+		char local[64];
+		std::vector<char> heap;
+		char* stack = line.size() < sizeof(local) ? local : (heap.resize(line.size() + 1), heap.data());
+		stack[0] = 'E';
+		return step(line.data(), 0, line.size(), stack, 1);
+	}
+}
+
+struct Recognizer
+{
+	const char* grammar;
+	bool (*recognize)(const std::string&);
+};
+
+const Recognizer recognizers[] = {
+	{"grammar1.txt", grammar1::recognize},
+	{"grammar2.txt", grammar2::recognize},
+	{"grammar3.txt", grammar3::recognize},
+};
+}
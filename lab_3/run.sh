@@ -1,6 +1,8 @@
 #!/bin/bash
 
-SOURCE_FILE="*.cpp"
+# Быстрая сборка одной лабораторной; общая сборка с LTO, PGO и замерами - CMakeLists.txt в корне
+
+SOURCE_FILE="main.cpp"
 EXECUTABLE="prog"
 
 if [ ! -f "$SOURCE_FILE" ]; then
@@ -9,7 +11,7 @@ if [ ! -f "$SOURCE_FILE" ]; then
 fi
 
 echo "Компиляция $SOURCE_FILE..."
-g++ -o "$EXECUTABLE" "$SOURCE_FILE"
+g++ -std=c++17 -O2 -pthread -o "$EXECUTABLE" "$SOURCE_FILE"
 
 if [ $? -ne 0 ]; then
   echo "Ошибка компиляции."
@@ -17,7 +19,7 @@ if [ $? -ne 0 ]; then
 fi
 
 echo "Запуск $EXECUTABLE..."
-./"$EXECUTABLE"
+./"$EXECUTABLE" "$@"
 
 if [ $? -ne 0 ]; then
   echo "Ошибка выполнения."
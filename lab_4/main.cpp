@@ -7,265 +7,1042 @@
 #include <unordered_map>
 #include <initializer_list>
 #include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <filesystem>
+#include <glob.h>
+#include <string_view>
+#include <memory>
+#include <iterator>
+#include <cstdint>
+#include <array>
+#ifdef LAB_BENCHMARK
+#include "../bench/bench.h"
+#endif
+#if !defined(LEXER_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define LEXER_SIMD 1
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
+// Уровни трассировки парсера
+enum TraceLevel {
+    TRACE_OFF = 0,      // Трассировка отключена
+    TRACE_RECOVERY = 1, // Восстановление после ошибок (PANIC)
+    TRACE_RULES = 2,    // Правила грамматики (DECLARATION, ...)
+    TRACE_TOKENS = 3    // Каждый ожидаемый токен (EXPECT)
+};
+
+// Уровень трассировки, вкомпилированный в программу (g++ -DPARSER_TRACE_LEVEL=3 ...)
+#ifndef PARSER_TRACE_LEVEL
+#define PARSER_TRACE_LEVEL TRACE_OFF
+#endif
+
+constexpr int compiledTraceLevel = PARSER_TRACE_LEVEL;
+
+// Буферизованный приёмник трассировки, отдельный от диагностики в cerr
+class TraceSink {
+private:
+    ostream& out;
+    string buffer;
+    static const size_t flushThreshold = 1 << 16;
+
+public:
+    TraceSink(ostream& out = clog) : out(out) {}
+
+    ~TraceSink() {
+        flush();
+    }
+
+    void write(const string& text) {
+        buffer += text;
+        if (buffer.size() >= flushThreshold) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            out.write(buffer.data(), buffer.size());
+            out.flush();
+            buffer.clear();
+        }
+    }
+};
+
+// Трассировщик: уровень времени компиляции отсекает вызовы целиком,
+// уровень времени выполнения позволяет дополнительно ограничить вывод
+class Tracer {
+private:
+    TraceSink sink;
+    int runtimeLevel;
+
+public:
+    Tracer(int runtimeLevel = compiledTraceLevel) : runtimeLevel(runtimeLevel) {}
+
+    void setLevel(int level) {
+        runtimeLevel = level;
+    }
+
+    template <int Level, typename... Args>
+    void trace(const Args&... args) {
+        if constexpr (Level <= compiledTraceLevel) {
+            if (Level <= runtimeLevel) {
+                string line;
+                (append(line, args), ...);
+                line += '\n';
+                sink.write(line);
+            }
+        }
+    }
+
+private:
+    static void append(string& line, const string& value) {
+        line += value;
+    }
+
+    static void append(string& line, const char* value) {
+        line += value;
+    }
+
+    static void append(string& line, char value) {
+        line += value;
+    }
+};
+
+// Возможные типы токенов, в том же порядке, что и имена в tokenNames
+enum TokenType : uint8_t {
+    TOKEN_TYPE, TOKEN_MAIN, TOKEN_FOR, TOKEN_IF, TOKEN_RETURN,
+    TOKEN_IDENTIFIER, TOKEN_NUMBER, TOKEN_BOOL,
+    TOKEN_ASSIGN, TOKEN_SEMICOLON, TOKEN_LBRACE, TOKEN_RBRACE,
+    TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_RELOP, TOKEN_EOF, TOKEN_UNKNOWN
+};
+
+const char* const tokenNames[] = {
+    "TYPE", "MAIN", "FOR", "IF", "RETURN",
+    "IDENTIFIER", "NUMBER", "BOOL",
+    "ASSIGN", "SEMICOLON", "LBRACE", "RBRACE",
+    "LPAREN", "RPAREN", "RELOP", "EOF", "UNKNOWN"
+};
+
+// Множество типов токенов: бит на тип
+using TokenSet = uint32_t;
+
+constexpr TokenSet tokenSet(initializer_list<TokenType> kinds) {
+    TokenSet set = 0;
+    for (TokenType kind : kinds) {
+        set |= TokenSet(1) << kind;
+    }
+    return set;
+}
+
+constexpr bool inSet(TokenSet set, TokenType kind) {
+    return (set >> kind) & 1;
+}
+
+// Множества синхронизации восстановления после ошибок, выведенные из грамматики:
+// FIRST(<statement>) и FOLLOW для <statement>, <declaration> и <bool_expression>
+constexpr TokenSet FIRST_STATEMENT = tokenSet({TOKEN_TYPE, TOKEN_LBRACE, TOKEN_FOR, TOKEN_IF, TOKEN_RETURN, TOKEN_RBRACE});
+constexpr TokenSet FOLLOW_STATEMENT = FIRST_STATEMENT | tokenSet({TOKEN_EOF});
+constexpr TokenSet FOLLOW_DECLARATION = tokenSet({TOKEN_SEMICOLON});
+constexpr TokenSet FOLLOW_BOOL_EXPRESSION = tokenSet({TOKEN_SEMICOLON, TOKEN_RPAREN});
+// Ошибка внутри объявления: ждём его конца или начала следующего оператора
+constexpr TokenSet SYNC_DECLARATION = FOLLOW_DECLARATION | FIRST_STATEMENT;
+
+// Сколько ошибок выводится, прежде чем разбор останавливается
+const int MAX_DIAGNOSTICS = 100;
+
 // Структура для хранения токенов
 struct Token {
     string type;    // Тип токена
     string value;   // Значение токена
     int line;       // Строка в которой находится токен
+    size_t offset = 0;  // Смещение начала токена в тексте
+    size_t length = 0;  // Длина токена в тексте
+    TokenType kind = TOKEN_UNKNOWN;  // Тип токена числом, для сравнений в парсере
 };
 
-// Возможные типы токенов
-enum TokenType {
-    TOKEN_INT, TOKEN_BOOL, TOKEN_VOID,
-    TOKEN_MAIN, TOKEN_FOR, TOKEN_IF, TOKEN_RETURN,
-    TOKEN_IDENTIFIER, TOKEN_NUMBER,
-    TOKEN_ASSIGN, TOKEN_SEMICOLON, TOKEN_LBRACE, TOKEN_RBRACE,
-    TOKEN_LPAREN, TOKEN_RPAREN, TOKEN_RELOP, TOKEN_EOF, TOKEN_UNKNOWN
-};
+// Классы символов лексера: как isspace/isalnum/isdigit в локали "C", но без вызовов библиотеки
+enum CharClass { CLASS_SPACE, CLASS_IDENTIFIER, CLASS_DIGIT };
+
+inline bool isSpaceChar(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool isDigitChar(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool isLetterChar(char c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+template <CharClass Class>
+inline bool inClass(char c) {
+    if constexpr (Class == CLASS_SPACE) {
+        return isSpaceChar(c);
+    } else if constexpr (Class == CLASS_DIGIT) {
+        return isDigitChar(c);
+    } else {
+        return isDigitChar(c) || isLetterChar(c) || c == '_';
+    }
+}
+
+// Длина серии символов класса Class с начала [begin, end); для пробелов
+// в newlines добавляется количество переводов строки в серии
+template <CharClass Class>
+size_t scanRunScalar(const char* begin, const char* end, size_t& newlines) {
+    const char* p = begin;
+    while (p < end && inClass<Class>(*p)) {
+        if (Class == CLASS_SPACE && *p == '\n') {
+            newlines++;
+        }
+        p++;
+    }
+    return p - begin;
+}
+
+#ifdef LEXER_SIMD
+// SSE2: 16 байт за шаг, маска символов класса через сравнения со знаком
+// (байты >= 0x80 отрицательны и ни в один класс не попадают)
+template <CharClass Class>
+size_t scanRunSse2(const char* begin, const char* end, size_t& newlines) {
+    const char* p = begin;
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+        __m128i match;
+        if constexpr (Class == CLASS_SPACE) {
+            match = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                                 _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('\r' + 1))));
+        } else if constexpr (Class == CLASS_DIGIT) {
+            match = digits;
+        } else {
+            __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+            __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+            match = _mm_or_si128(_mm_or_si128(digits, letters), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+        }
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(match) & 0xFFFF;
+        size_t length = stop ? __builtin_ctz(stop) : 16;
+        if constexpr (Class == CLASS_SPACE) {
+            uint32_t lines = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+            newlines += __builtin_popcount(lines & ((1u << length) - 1));
+        }
+        p += length;
+        if (stop) {
+            return p - begin;
+        }
+    }
+    return (p - begin) + scanRunScalar<Class>(p, end, newlines);
+}
+
+// AVX2: то же по 32 байта
+template <CharClass Class>
+__attribute__((target("avx2"))) size_t scanRunAvx2(const char* begin, const char* end, size_t& newlines) {
+    const char* p = begin;
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+        __m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+        __m256i match;
+        if constexpr (Class == CLASS_SPACE) {
+            match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                                    _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('\t' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), chunk)));
+        } else if constexpr (Class == CLASS_DIGIT) {
+            match = digits;
+        } else {
+            __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+            __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+            match = _mm256_or_si256(_mm256_or_si256(digits, letters), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+        }
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(match);
+        size_t length = stop ? __builtin_ctz(stop) : 32;
+        if constexpr (Class == CLASS_SPACE) {
+            uint32_t lines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+            newlines += __builtin_popcountll(lines & ((1ull << length) - 1));
+        }
+        p += length;
+        if (stop) {
+            return p - begin;
+        }
+    }
+    return (p - begin) + scanRunSse2<Class>(p, end, newlines);
+}
+#endif
+
+// Выбор реализации: AVX2, если процессор поддерживает, иначе SSE2;
+// без SIMD (или с -DLEXER_NO_SIMD) - скалярный цикл
+template <CharClass Class>
+size_t scanRun(const char* begin, const char* end, size_t& newlines) {
+#ifdef LEXER_SIMD
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) {
+        return scanRunAvx2<Class>(begin, end, newlines);
+    }
+    return scanRunSse2<Class>(begin, end, newlines);
+#else
+    return scanRunScalar<Class>(begin, end, newlines);
+#endif
+}
 
 // Лексический анализатор
+// Текст разбирается из памяти: файл читается целиком, токены хранят смещения
 class Lexer {
 private:
-    ifstream file;
+    string storage;    // Содержимое файла, если лексер читал его сам
+    string_view text;  // Разбираемый текст
+    size_t pos;        // Позиция текущего символа
     int line;
     char currentChar;
 
 public:
-    Lexer(const string& filename) : line(1) {
-        file.open(filename);
+    Lexer(const string& filename) : pos(0), line(1) {
+        ifstream file(filename, ios::binary);
         if (!file.is_open()) {
-            cerr << "Ошибка при открытии файла: " << filename << endl;
-            exit(1);
+            throw runtime_error("Ошибка при открытии файла: " + filename);
         }
-        currentChar = file.get();
+        storage.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        text = storage;
+        currentChar = charAt(pos);
+    }
+
+    // Лексер по тексту в памяти, начиная с заданной позиции и строки
+    Lexer(string_view text, size_t offset, int line) : text(text), pos(offset), line(line) {
+        currentChar = charAt(pos);
     }
 
     // Проверка конца файла
     bool isEOF() {
-        return file.eof();
+        return pos >= text.size();
     }
 
     // Пропуск пробелов и комментариев
     void skipWhitespace() {
-        while (isspace(currentChar)) {
-            if (currentChar == '\n') line++;
-            currentChar = file.get();
-        }
+        size_t newlines = 0;
+        skip(scanRun<CLASS_SPACE>(text.data() + pos, text.data() + text.size(), newlines));
+        line += newlines;
     }
 
-    // Возвращает следующий токен
+    // Возвращает следующий токен вместе с его положением в тексте
     Token nextToken() {
         skipWhitespace();
+        size_t start = pos;
+        Token token = scanToken();
+        token.offset = start;
+        token.length = pos - start;
+        return token;
+    }
 
+private:
+    char charAt(size_t index) const {
+        return index < text.size() ? text[index] : '\0';
+    }
+
+    void nextChar() {
+        if (pos < text.size()) {
+            pos++;
+        }
+        currentChar = charAt(pos);
+    }
+
+    void skip(size_t count) {
+        pos += count;
+        currentChar = charAt(pos);
+    }
+
+    Token make(TokenType kind, string value) const {
+        Token token{tokenNames[kind], std::move(value), line};
+        token.kind = kind;
+        return token;
+    }
+
+    Token scanToken() {
         // Если конец файла
         if (isEOF()) {
-            return {"EOF", "", line};
+            return make(TOKEN_EOF, "");
         }
 
         // Идентификатор или ключевое слово
-        if (isalpha(currentChar) || currentChar == '_') {
-            string identifier;
-            while (isalnum(currentChar) || currentChar == '_') {
-                identifier += currentChar;
-                currentChar = file.get();
-            }
-
-            if (identifier == "int") return {"TYPE", "int", line};
-            if (identifier == "bool") return {"TYPE", "bool", line};
-            if (identifier == "void") return {"TYPE", "void", line};
-            if (identifier == "main") return {"MAIN", "main", line};
-            if (identifier == "for") return {"FOR", "for", line};
-            if (identifier == "if") return {"IF", "if", line};
-            if (identifier == "return") return {"RETURN", "return", line};
+        if (isLetterChar(currentChar) || currentChar == '_') {
+            size_t newlines = 0;
+            string identifier(text.substr(pos, scanRun<CLASS_IDENTIFIER>(text.data() + pos, text.data() + text.size(), newlines)));
+            skip(identifier.size());
+
+            if (identifier == "int") return make(TOKEN_TYPE, "int");
+            if (identifier == "bool") return make(TOKEN_TYPE, "bool");
+            if (identifier == "void") return make(TOKEN_TYPE, "void");
+            if (identifier == "main") return make(TOKEN_MAIN, "main");
+            if (identifier == "for") return make(TOKEN_FOR, "for");
+            if (identifier == "if") return make(TOKEN_IF, "if");
+            if (identifier == "return") return make(TOKEN_RETURN, "return");
             
-           if (identifier == "true" || identifier == "false") return {"BOOL", identifier, line};
+           if (identifier == "true" || identifier == "false") return make(TOKEN_BOOL, identifier);
 
 
-            return {"IDENTIFIER", identifier, line};
+            return make(TOKEN_IDENTIFIER, identifier);
         }
 
         // Число
-        if (isdigit(currentChar)) {
-            string number;
-            while (isdigit(currentChar)) {
-                number += currentChar;
-                currentChar = file.get();
-            }
-            return {"NUMBER", number, line};
+        if (isDigitChar(currentChar)) {
+            size_t newlines = 0;
+            string number(text.substr(pos, scanRun<CLASS_DIGIT>(text.data() + pos, text.data() + text.size(), newlines)));
+            skip(number.size());
+            return make(TOKEN_NUMBER, number);
         }
 
         // Операторы
         if (currentChar == '=') {
-            currentChar = file.get();
+            nextChar();
             if (currentChar == '=') {
-                currentChar = file.get();
-                return {"RELOP", "==", line};
+                nextChar();
+                return make(TOKEN_RELOP, "==");
             }
-            return {"ASSIGN", "=", line};
+            return make(TOKEN_ASSIGN, "=");
         }
         if (currentChar == '<') {
-            currentChar = file.get();
-            return {"RELOP", "<", line};
+            nextChar();
+            return make(TOKEN_RELOP, "<");
         }
         if (currentChar == '>') {
-            currentChar = file.get();
-            return {"RELOP", ">", line};
+            nextChar();
+            return make(TOKEN_RELOP, ">");
         }
         if (currentChar == '!') {
-            currentChar = file.get();
+            nextChar();
             if (currentChar == '=') {
-                currentChar = file.get();
-                return {"RELOP", "!=", line};
+                nextChar();
+                return make(TOKEN_RELOP, "!=");
             }
         }
 
         // Разделители
         if (currentChar == ';') {
-            currentChar = file.get();
-            return {"SEMICOLON", ";", line};
+            nextChar();
+            return make(TOKEN_SEMICOLON, ";");
         }
         if (currentChar == '{') {
-            currentChar = file.get();
-            return {"LBRACE", "{", line};
+            nextChar();
+            return make(TOKEN_LBRACE, "{");
         }
         if (currentChar == '}') {
-            currentChar = file.get();
-            return {"RBRACE", "}", line};
+            nextChar();
+            return make(TOKEN_RBRACE, "}");
         }
         if (currentChar == '(') {
-            currentChar = file.get();
-            return {"LPAREN", "(", line};
+            nextChar();
+            return make(TOKEN_LPAREN, "(");
         }
         if (currentChar == ')') {
-            currentChar = file.get();
-            return {"RPAREN", ")", line};
+            nextChar();
+            return make(TOKEN_RPAREN, ")");
         }
 
         // Неизвестный символ
         string unknown(1, currentChar);
-        currentChar = file.get();
-        return {"UNKNOWN", unknown, line};
+        nextChar();
+        return make(TOKEN_UNKNOWN, unknown);
+    }
+};
+
+// Таблица символов с журналом записей и отпечатком содержимого.
+// Журнал и отпечаток нужны инкрементальному разбору, чтобы повторять
+// действия сохранённых операторов и сравнивать состояние таблицы за O(1)
+class SymbolTable {
+private:
+    unordered_map<string, string> entries;
+    vector<pair<string, string>> journal;
+    bool journaling = false;
+    uint64_t fingerprint = 0;
+
+    static uint64_t mix(uint64_t value) {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    static uint64_t entryHash(const string& name, const string& type) {
+        return mix(hash<string>()(name) ^ mix(hash<string>()(type)));
+    }
+
+public:
+    bool contains(const string& name) const {
+        return entries.count(name) > 0;
+    }
+
+    // Как operator[]: необъявленное имя добавляется с пустым типом
+    const string& get(const string& name) {
+        auto it = entries.find(name);
+        if (it == entries.end()) {
+            set(name, "");
+            return entries[name];
+        }
+        return it->second;
+    }
+
+    void set(const string& name, const string& type) {
+        auto it = entries.find(name);
+        if (it != entries.end()) {
+            fingerprint -= entryHash(name, it->second);
+            it->second = type;
+        } else {
+            entries[name] = type;
+        }
+        fingerprint += entryHash(name, type);
+        if (journaling) {
+            journal.emplace_back(name, type);
+        }
+    }
+
+    void enableJournal() {
+        journaling = true;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    uint64_t getFingerprint() const {
+        return fingerprint;
+    }
+
+    const vector<pair<string, string>>& getJournal() const {
+        return journal;
+    }
+};
+
+// Сообщение об ошибке
+struct Diagnostic {
+    int line;
+    string text;
+};
+
+// Сохранённый результат разбора оператора <statement> для инкрементального режима.
+// Оператор видит только токены от своего начала до текущего токена на выходе,
+// поэтому результат можно переиспользовать, пока эти токены и состояние на входе не менялись
+struct StatementMemo {
+    bool valid = false;
+    size_t tokenCount = 0;                   // Просмотренные токены, включая последний текущий
+    size_t symbolsBefore = 0;                // Состояние таблицы символов на входе
+    uint64_t fingerprintBefore = 0;
+    string functionType;
+    vector<pair<string, string>> writes;     // Записи в таблицу символов
+    vector<Diagnostic> diagnostics;          // Строки относительно первого токена
+    bool recoveringAfter = false;            // Оператор закончился во время восстановления после ошибки
+};
+
+// Кольцевой буфер без блокировок для одного производителя и одного потребителя
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Ёмкость должна быть степенью двойки");
+
+private:
+    array<T, Capacity> slots;
+    alignas(64) atomic<size_t> head{0};  // Следующий элемент для чтения (пишет потребитель)
+    alignas(64) atomic<size_t> tail{0};  // Следующий свободный слот (пишет производитель)
+
+public:
+    bool tryPush(T& value) {
+        size_t currentTail = tail.load(memory_order_relaxed);
+        if (currentTail - head.load(memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[currentTail & (Capacity - 1)] = std::move(value);
+        tail.store(currentTail + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t currentHead = head.load(memory_order_relaxed);
+        if (currentHead == tail.load(memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[currentHead & (Capacity - 1)]);
+        head.store(currentHead + 1, memory_order_release);
+        return true;
+    }
+};
+
+// Лексер в отдельном потоке: токены передаются парсеру через кольцевой буфер
+class PipelinedLexer {
+private:
+    Lexer lexer;
+    SpscRing<Token, 4096> ring;
+    atomic<bool> stopped{false};
+    thread worker;
+
+public:
+    PipelinedLexer(const string& filename) : lexer(filename) {
+        worker = thread([this] { produce(); });
+    }
+
+    ~PipelinedLexer() {
+        stopped.store(true, memory_order_relaxed);
+        worker.join();
+    }
+
+    Token nextToken() {
+        Token token;
+        while (!ring.tryPop(token)) {
+            this_thread::yield();
+        }
+        return token;
+    }
+
+private:
+    void produce() {
+        while (true) {
+            Token token = lexer.nextToken();
+            bool last = token.kind == TOKEN_EOF;
+            while (!ring.tryPush(token)) {
+                if (stopped.load(memory_order_relaxed)) {
+                    return;
+                }
+                this_thread::yield();
+            }
+            if (last) {
+                return;
+            }
+        }
+    }
+};
+
+// Команды байт-кода. Константы лежат в слотах наравне с переменными,
+// поэтому у всех команд одинаковые операнды: номера слотов и адрес перехода
+enum Opcode : uint8_t {
+    OP_MOVE,     // slots[a] = slots[b]
+    OP_JUMP,     // pc = target
+    OP_JUMP_LT,  // if (slots[a] < slots[b]) pc = target
+    OP_JUMP_GT,
+    OP_JUMP_EQ,
+    OP_JUMP_NE,
+    OP_JUMP_GE,
+    OP_JUMP_LE,
+    OP_RETURN,   // результат - slots[a]
+    OP_HALT      // конец программы без return
+};
+
+struct Instruction {
+    Opcode op;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t target = 0;
+};
+
+// Условие <bool_expression>: слоты операндов и переход, выполняемый при истине
+struct Condition {
+    int left = 0;
+    int right = 0;
+    Opcode jumpIfTrue = OP_JUMP_LT;
+};
+
+struct Bytecode {
+    vector<Instruction> code;
+    vector<int64_t> slots;     // Начальные значения: переменные - 0, константы - сами значения
+    vector<string> slotNames;  // Имена слотов для вывода
+    string functionType;
+};
+
+// Сборщик байт-кода: парсер вызывает его по ходу разбора,
+// и имена переменных сразу заменяются номерами слотов
+class BytecodeCompiler {
+private:
+    Bytecode bytecode;
+    unordered_map<string, int> variables;
+    unordered_map<string, int> constants;  // По тексту литерала: false и 0 - разные слоты со своими именами
+
+public:
+    int variable(const string& name) {
+        auto found = variables.find(name);
+        if (found != variables.end()) {
+            return found->second;
+        }
+        return variables[name] = addSlot(0, name);
+    }
+
+    // Константа из литерала: число, true или false
+    int constant(const string& literal) {
+        auto found = constants.find(literal);
+        if (found != constants.end()) {
+            return found->second;
+        }
+        int64_t value = literal == "true" ? 1 : literal == "false" ? 0 : strtoll(literal.c_str(), nullptr, 10);
+        return constants[literal] = addSlot(value, literal);
+    }
+
+    size_t emit(Opcode op, int a = 0, int b = 0, int target = 0) {
+        bytecode.code.push_back({op, a, b, target});
+        return bytecode.code.size() - 1;
+    }
+
+    size_t here() const {
+        return bytecode.code.size();
+    }
+
+    // Переход по адресу index ведёт на следующую команду
+    void patch(size_t index) {
+        bytecode.code[index].target = here();
+    }
+
+    void setFunctionType(const string& type) {
+        bytecode.functionType = type;
+    }
+
+    Bytecode finish() {
+        emit(OP_HALT);
+        return std::move(bytecode);
+    }
+
+    static Opcode relation(const string& relop) {
+        if (relop == "<") return OP_JUMP_LT;
+        if (relop == ">") return OP_JUMP_GT;
+        if (relop == "==") return OP_JUMP_EQ;
+        return OP_JUMP_NE;
+    }
+
+    static Opcode negate(Opcode op) {
+        switch (op) {
+        case OP_JUMP_LT: return OP_JUMP_GE;
+        case OP_JUMP_GT: return OP_JUMP_LE;
+        case OP_JUMP_EQ: return OP_JUMP_NE;
+        case OP_JUMP_NE: return OP_JUMP_EQ;
+        case OP_JUMP_GE: return OP_JUMP_LT;
+        case OP_JUMP_LE: return OP_JUMP_GT;
+        default: return op;
+        }
+    }
+
+private:
+    int addSlot(int64_t value, const string& name) {
+        bytecode.slots.push_back(value);
+        bytecode.slotNames.push_back(name);
+        return bytecode.slots.size() - 1;
     }
 };
 
 // Синтаксический анализатор
 class Parser {
 private:
-    Lexer lexer;
+    unique_ptr<Lexer> lexer;               // Потоковый режим: токены читаются из лексера
+    unique_ptr<PipelinedLexer> pipeline;   // Конвейерный режим: лексер в отдельном потоке
+    const vector<Token>* tokens = nullptr; // Инкрементальный режим: готовый вектор токенов
+    vector<StatementMemo>* memo = nullptr; // Результаты операторов по номеру первого токена
+    size_t position = 0;                   // Номер текущего токена
+    size_t reusedStatements = 0;
+    size_t parsedStatements = 0;
+    vector<Diagnostic> diagnosticLog;
     Token currentToken;
     int errorCount;
-    unordered_map<string, string> symbolTable;
+    bool recovering = false;  // После ошибки, пока не сопоставлен ожидаемый токен
+    bool stopped = false;     // Достигнут предел MAX_DIAGNOSTICS
+    SymbolTable symbolTable;
     string function_type;
+    BytecodeCompiler* compiler = nullptr;  // Если задан, по ходу разбора строится байт-код
+    Tracer tracer;
+    ostream& diagnostics;  // Поток для сообщений об ошибках
+    ostream& output;       // Поток для итогового сообщения
 
 public:
-    Parser(const string& filename) : lexer(filename), errorCount(0) {
-        currentToken = lexer.nextToken();
+    Parser(const string& filename, ostream& diagnostics = cerr, ostream& output = cout)
+        : lexer(new Lexer(filename)), errorCount(0), diagnostics(diagnostics), output(output) {
+        currentToken = lexer->nextToken();
+    }
+
+    // Конвейерный режим: лексер работает в отдельном потоке
+    Parser(const string& filename, bool pipelined, ostream& diagnostics = cerr, ostream& output = cout)
+        : errorCount(0), diagnostics(diagnostics), output(output) {
+        if (pipelined) {
+            pipeline.reset(new PipelinedLexer(filename));
+            currentToken = pipeline->nextToken();
+        } else {
+            lexer.reset(new Lexer(filename));
+            currentToken = lexer->nextToken();
+        }
+    }
+
+    // Разбор готового вектора токенов (последний токен - EOF) с кэшем операторов
+    Parser(const vector<Token>& tokens, vector<StatementMemo>& memo, ostream& diagnostics = cerr, ostream& output = cout)
+        : tokens(&tokens), memo(&memo), errorCount(0), diagnostics(diagnostics), output(output) {
+        currentToken = tokens[0];
+        symbolTable.enableJournal();
+    }
+
+    int getErrorCount() const {
+        return errorCount;
+    }
+
+    size_t getReusedStatements() const {
+        return reusedStatements;
+    }
+
+    size_t getParsedStatements() const {
+        return parsedStatements;
+    }
+
+    void setCompiler(BytecodeCompiler* target) {
+        compiler = target;
+    }
+
+    // Уровень трассировки времени выполнения (не выше вкомпилированного)
+    void setTraceLevel(int level) {
+        tracer.setLevel(level);
     }
 
     // Получение следующего токена
     void advance() {
-        currentToken = lexer.nextToken();
+        if (stopped) {
+            return;
+        }
+        if (tokens) {
+            if (position + 1 < tokens->size()) {
+                position++;
+            }
+            currentToken = (*tokens)[position];
+        } else if (pipeline) {
+            // После EOF лексер больше ничего не передаёт
+            if (currentToken.kind != TOKEN_EOF) {
+                currentToken = pipeline->nextToken();
+            }
+        } else {
+            currentToken = lexer->nextToken();
+        }
     }
 
-    // Ошибка
-    void error(const string& message) {
-        cerr << "Ошибка в строке " << currentToken.line << ": " << message << " (текущий токен: " << currentToken.value << ")" << endl;
+    // Команда байт-кода, если он строится
+    size_t emit(Opcode op, int a = 0, int b = 0, int target = 0) {
+        return compiler ? compiler->emit(op, a, b, target) : 0;
+    }
+
+    size_t here() const {
+        return compiler ? compiler->here() : 0;
+    }
+
+    void patch(size_t index) {
+        if (compiler) {
+            compiler->patch(index);
+        }
+    }
+
+    // Слот операнда: переменная или константа
+    int slotOf(const Token& token) {
+        if (!compiler) {
+            return 0;
+        }
+        return token.kind == TOKEN_IDENTIFIER ? compiler->variable(token.value) : compiler->constant(token.value);
+    }
+
+    // Вывод сообщения об ошибке. После MAX_DIAGNOSTICS ошибок разбор
+    // останавливается: текущим становится EOF, и все правила завершаются
+    void report(const Diagnostic& diagnostic) {
+        if (stopped) {
+            return;
+        }
+        diagnostics << "Ошибка в строке " << diagnostic.line << ": " << diagnostic.text << endl;
         errorCount++;
+        if (memo) {
+            diagnosticLog.push_back(diagnostic);
+        }
+        if (errorCount >= MAX_DIAGNOSTICS) {
+            diagnostics << "Слишком много ошибок, разбор остановлен" << endl;
+            stop();
+        }
+    }
+
+    void stop() {
+        stopped = true;
+        if (tokens) {
+            position = tokens->size() - 1;
+            currentToken = (*tokens)[position];
+        } else {
+            Token eof{tokenNames[TOKEN_EOF], "", currentToken.line};
+            eof.kind = TOKEN_EOF;
+            currentToken = eof;
+        }
+    }
+
+    // Ошибка. Пока разбор восстанавливается после предыдущей ошибки, новые
+    // сообщения не выводятся: обычно это следствие той же ошибки
+    void error(const string& message) {
+        if (!recovering) {
+            report({currentToken.line, message + " (текущий токен: " + currentToken.value + ")"});
+        }
         panicMode();
     }
     
-    void error(const string& message, initializer_list<string> expected) {
-        cerr << "Ошибка в строке " << currentToken.line << ": " << message << " (текущий токен: " << currentToken.value << ")" << endl;
-        errorCount++;
-        panicMode(expected);
+    void error(const string& message, TokenSet follow) {
+        if (!recovering) {
+            report({currentToken.line, message + " (текущий токен: " + currentToken.value + ")"});
+        }
+        panicMode(follow);
     }
 
     void panicMode() {
-        cout << "PANIC " << currentToken.type << endl;
+        tracer.trace<TRACE_RECOVERY>("PANIC ", currentToken.type);
+        recovering = true;
         advance();
-        cout << "PANIC 2 " << currentToken.type << endl;
+        tracer.trace<TRACE_RECOVERY>("PANIC 2 ", currentToken.type);
     }
     
-    void panicMode(initializer_list<string> expected) {
-        cout << "EXPECTED PANIC ";
-        for (const auto& type : expected) {
-            cout << type << " ";
+    // Пропуск токенов до одного из множества синхронизации (или EOF):
+    // на каждый токен одна проверка бита
+    void panicMode(TokenSet follow) {
+        if constexpr (TRACE_RECOVERY <= compiledTraceLevel) {
+            string types;
+            for (int kind = 0; kind <= TOKEN_UNKNOWN; kind++) {
+                if (inSet(follow, TokenType(kind))) {
+                    types += string(tokenNames[kind]) + " ";
+                }
+            }
+            tracer.trace<TRACE_RECOVERY>("EXPECTED PANIC ", types);
         }
-        cout << endl;
-    
     
-        while (find(expected.begin(), expected.end(), currentToken.type) == expected.end() && currentToken.type != "EOF") {
+        recovering = true;
+        follow |= tokenSet({TOKEN_EOF});
+        while (!inSet(follow, currentToken.kind)) {
             advance();
         }
     
-        cout << "EXPECTED PANIC OUT 1 " << currentToken.type << endl;
+        tracer.trace<TRACE_RECOVERY>("EXPECTED PANIC OUT 1 ", currentToken.type);
     }
-    // Проверка и ожидание токена
-    void expect(const string& expectedType) {
-        cout << "EXPECT " << expectedType << " " << currentToken.type << endl;
-        if (currentToken.type == expectedType) {
+
+    // Проверка и ожидание токена. При ошибке токены пропускаются до ожидаемого
+    // или до токена из follow; ожидаемый токен, если найден, поглощается
+    void expect(TokenType expected, TokenSet follow = 0) {
+        tracer.trace<TRACE_TOKENS>("EXPECT ", tokenNames[expected], " ", currentToken.type);
+        if (currentToken.kind == expected) {
+            recovering = false;
+            advance();
+            return;
+        }
+        error(string("Ожидался ") + tokenNames[expected], follow | tokenSet({expected}));
+        if (currentToken.kind == expected) {
             advance();
-        } else {
-            error("Ожидался " + expectedType, {expectedType});
         }
     }
 
     // <program> ::= <type> 'main' '(' ')' '{' <statement> '}'
     void program() {
         type(true);
-        expect("MAIN");
-        expect("LPAREN");
-        expect("RPAREN");
-        expect("LBRACE");
+        if (compiler) {
+            compiler->setFunctionType(function_type);
+        }
+        expect(TOKEN_MAIN);
+        expect(TOKEN_LPAREN);
+        expect(TOKEN_RPAREN);
+        expect(TOKEN_LBRACE);
         statement();
-        expect("RBRACE");
+        expect(TOKEN_RBRACE);
     }
 
     // <type> ::= 'int' | 'bool' | 'void'
     void type(bool function) {
-        if (currentToken.type == "TYPE") {
+        if (currentToken.kind == TOKEN_TYPE) {
             if(function) {
                 function_type = currentToken.value;
             }
             advance();
-        } else {
+        } else if (function) {
             error("Ожидался тип данных (int, bool или void)");
+        } else {
+            error("Ожидался тип данных (int, bool или void)", SYNC_DECLARATION);
         }
     }
 
-    // <statement> ::= <declaration> ';' | '{' <statement> '}' | <for> <statement> | <if> <statement> | <return>
+    // В инкрементальном режиме неизменённый оператор берётся из кэша
     void statement() {
-        if (currentToken.type == "LBRACE") {
+        recovering = false;
+        if (!memo) {
+            statementBody();
+            return;
+        }
+
+        size_t start = position;
+        StatementMemo& cached = (*memo)[start];
+        if (cached.valid && cached.symbolsBefore == symbolTable.size()
+            && cached.fingerprintBefore == symbolTable.getFingerprint() && cached.functionType == function_type) {
+            replay(cached, start);
+            return;
+        }
+
+        size_t journalBefore = symbolTable.getJournal().size();
+        size_t diagnosticsBefore = diagnosticLog.size();
+        StatementMemo result;
+        result.symbolsBefore = symbolTable.size();
+        result.fingerprintBefore = symbolTable.getFingerprint();
+        result.functionType = function_type;
+
+        statementBody();
+        parsedStatements++;
+
+        int firstLine = (*tokens)[start].line;
+        const auto& journal = symbolTable.getJournal();
+        result.writes.assign(journal.begin() + journalBefore, journal.end());
+        for (size_t i = diagnosticsBefore; i < diagnosticLog.size(); i++) {
+            result.diagnostics.push_back({diagnosticLog[i].line - firstLine, diagnosticLog[i].text});
+        }
+        result.tokenCount = position - start + 1;
+        result.recoveringAfter = recovering;
+        result.valid = true;
+        (*memo)[start] = std::move(result);
+    }
+
+    // Повтор сохранённого оператора без разбора
+    void replay(const StatementMemo& cached, size_t start) {
+        int firstLine = (*tokens)[start].line;
+        for (const auto& write : cached.writes) {
+            symbolTable.set(write.first, write.second);
+        }
+        for (const auto& diagnostic : cached.diagnostics) {
+            report({diagnostic.line + firstLine, diagnostic.text});
+        }
+        if (stopped) {
+            return;
+        }
+        position = start + cached.tokenCount - 1;
+        currentToken = (*tokens)[position];
+        recovering = cached.recoveringAfter;
+        reusedStatements++;
+    }
+
+    // <statement> ::= <declaration> ';' | '{' <statement> '}' | <for> <statement> | <if> <statement> | <return>
+    void statementBody() {
+        if (currentToken.kind == TOKEN_LBRACE) {
             advance();  // Пропускаем '{'
-            while (currentToken.type != "RBRACE" && currentToken.type != "EOF") {
+            while (currentToken.kind != TOKEN_RBRACE && currentToken.kind != TOKEN_EOF) {
                 statement();  // Рекурсивно обрабатываем другие операторы внутри блока
             }
-            expect("RBRACE");
-        } else if (currentToken.type == "FOR") {
+            expect(TOKEN_RBRACE);
+        } else if (currentToken.kind == TOKEN_FOR) {
             advance();
             forStatement();
             statement();
-        } else if (currentToken.type == "IF") {
+        } else if (currentToken.kind == TOKEN_IF) {
             advance();
-            ifStatement();
+            Condition condition = ifStatement();
+            size_t skip = emit(BytecodeCompiler::negate(condition.jumpIfTrue), condition.left, condition.right);
             statement();
-        } else if (currentToken.type == "RETURN") {
+            patch(skip);
+        } else if (currentToken.kind == TOKEN_RETURN) {
             advance();
             bool success = returnStatement();
             if(!success) {
                 advance();    
             }
             
-        } else if(currentToken.type == "RBRACE") {
+        } else if(currentToken.kind == TOKEN_RBRACE) {
             advance();
             
         } else {
-            cout << "DECLARATION " << currentToken.type << endl;
+            tracer.trace<TRACE_RULES>("DECLARATION ", currentToken.type);
             declaration();
-            expect("SEMICOLON");
+            expect(TOKEN_SEMICOLON, FOLLOW_STATEMENT);
         }
     }
     
@@ -273,34 +1050,37 @@ public:
     bool returnStatement() {
         string returnType = function_type;  // Получаем тип текущей функции (например, хранить его в контексте функции)
         
-        if (currentToken.type == "NUMBER") {
+        if (currentToken.kind == TOKEN_NUMBER) {
             if (returnType != "int") {
                 error("Несоответствие типов: ожидается " + returnType + ", но возвращено число.");
                 return false;
             }
+            emit(OP_RETURN, slotOf(currentToken));
             advance();
-        } else if (currentToken.type == "BOOL") {
+        } else if (currentToken.kind == TOKEN_BOOL) {
             if (returnType != "bool") {
                 error("Несоответствие типов: ожидается " + returnType + ", но возвращено булевое значение.");
                 
                 return false;
             }
+            emit(OP_RETURN, slotOf(currentToken));
             advance();
-        } else if (currentToken.type == "IDENTIFIER") {
+        } else if (currentToken.kind == TOKEN_IDENTIFIER) {
             string varName = currentToken.value;
-            if (symbolTable.find(varName) == symbolTable.end()) {
-                error("Переменная " + varName + " не объявлена.", {"SEMICOLON"});
+            if (!symbolTable.contains(varName)) {
+                error("Переменная " + varName + " не объявлена.", tokenSet({TOKEN_SEMICOLON}));
                 return false;
-            } else if (symbolTable[varName] != returnType) {
-                error("Несоответствие типов: ожидается " + returnType + ", но возвращена переменная типа " + symbolTable[varName] + ".");
+            } else if (symbolTable.get(varName) != returnType) {
+                error("Несоответствие типов: ожидается " + returnType + ", но возвращена переменная типа " + symbolTable.get(varName) + ".");
                 return false;
             }
+            emit(OP_RETURN, slotOf(currentToken));
             advance();
         } else {
             error("Некорректное возвращаемое значение.");
             return false;
         }
-        expect("SEMICOLON");  // После return ожидается ';'
+        expect(TOKEN_SEMICOLON);  // После return ожидается ';'
     
         return true;
     }
@@ -311,121 +1091,970 @@ public:
         string varType = currentToken.value;
         type(false);
         string varName = currentToken.value; 
-        expect("IDENTIFIER");
-        symbolTable[varName] = varType;
-        expect("ASSIGN");
+        expect(TOKEN_IDENTIFIER, SYNC_DECLARATION);
+        symbolTable.set(varName, varType);
+        expect(TOKEN_ASSIGN, SYNC_DECLARATION);
         assign(varName);
     }
 
     // <assign> ::= '=' (<identifier> | <number> | <bool>)
     void assign(const string& varName) {
-        string varType = symbolTable[varName];  // Получаем тип переменной
+        string varType = symbolTable.get(varName);  // Получаем тип переменной
     
-        if (currentToken.type == "NUMBER") {
+        if (currentToken.kind == TOKEN_NUMBER) {
             if (varType != "int") {  // Если тип переменной не соответствует числовому значению
                 error("Несоответствие типов: переменной " + varName + " (типа " + varType + ") присваивается число.");
                 return;
             }
+            emit(OP_MOVE, compiler ? compiler->variable(varName) : 0, slotOf(currentToken));
             advance();
-        } else if (currentToken.type == "IDENTIFIER") {
+        } else if (currentToken.kind == TOKEN_IDENTIFIER) {
             string assignedVar = currentToken.value;
     
-            if (symbolTable.find(assignedVar) == symbolTable.end()) {
-                error("Переменная " + assignedVar + " не объявлена.", {"SEMICOLON"});
-            } else if (symbolTable[assignedVar] != varType) {
-                error("Несоответствие типов: переменной " + varName + " (типа " + varType + ") присваивается значение переменной " + assignedVar + " (типа " + symbolTable[assignedVar] + ").");
+            if (!symbolTable.contains(assignedVar)) {
+                error("Переменная " + assignedVar + " не объявлена.", SYNC_DECLARATION);
+                return;
+            } else if (symbolTable.get(assignedVar) != varType) {
+                error("Несоответствие типов: переменной " + varName + " (типа " + varType + ") присваивается значение переменной " + assignedVar + " (типа " + symbolTable.get(assignedVar) + ").");
                 return;
             }
+            emit(OP_MOVE, compiler ? compiler->variable(varName) : 0, slotOf(currentToken));
             advance();
-        } else if (currentToken.type == "BOOL") {  // Добавляем проверку на булевые значения
+        } else if (currentToken.kind == TOKEN_BOOL) {  // Добавляем проверку на булевые значения
             if (varType != "bool") {
                 error("Несоответствие типов: переменной " + varName + " (типа " + varType + ") присваивается булевое значение.");
                 return;
             }
+            emit(OP_MOVE, compiler ? compiler->variable(varName) : 0, slotOf(currentToken));
             advance();
         } else {
-            error("Ожидался идентификатор, число или булевое значение после '='", {"NUMBER", "IDENTIFIER", "BOOL"});
+            error("Ожидался идентификатор, число или булевое значение после '='", SYNC_DECLARATION);
         }
     }
 
 
     // <for> ::= 'for' '(' <declaration> ';' <bool_expression> ';' ')'
+    // Байт-код: вход по обратному условию, тело, возврат к телу по прямому условию
     void forStatement() {
-        expect("LPAREN");
+        expect(TOKEN_LPAREN);
         declaration();
-        expect("SEMICOLON");
-        boolExpression();
-        expect("SEMICOLON");
-        expect("RPAREN");
+        expect(TOKEN_SEMICOLON);
+        Condition condition = boolExpression();
+        expect(TOKEN_SEMICOLON);
+        expect(TOKEN_RPAREN);
+        size_t exit = emit(BytecodeCompiler::negate(condition.jumpIfTrue), condition.left, condition.right);
+        size_t body = here();
         statement();
+        emit(condition.jumpIfTrue, condition.left, condition.right, body);
+        patch(exit);
     }
 
     // <bool_expression> ::= <identifier> <relop> <identifier> | <number> <relop> <identifier>
-    void boolExpression() {
+    Condition boolExpression() {
         string firstOperandType;
+        Condition condition;
         
-        if (currentToken.type == "IDENTIFIER") {
+        if (currentToken.kind == TOKEN_IDENTIFIER) {
             string varName = currentToken.value;
     
-            if (symbolTable.find(varName) == symbolTable.end()) {
-                error("Переменная " + varName + " не объявлена.", {"SEMICOLON"});
+            if (!symbolTable.contains(varName)) {
+                error("Переменная " + varName + " не объявлена.", FOLLOW_BOOL_EXPRESSION);
+                return condition;
             }
-            firstOperandType = symbolTable[varName];
+            firstOperandType = symbolTable.get(varName);
+            condition.left = slotOf(currentToken);
             advance();
-        } else if (currentToken.type == "NUMBER") {
+        } else if (currentToken.kind == TOKEN_NUMBER) {
             firstOperandType = "int";
+            condition.left = slotOf(currentToken);
             advance();
         } else {
-            error("Ожидалось выражение типа <bool_expression>", {"IDENTIFIER", "NUMBER"});
-            return;
+            error("Ожидалось выражение типа <bool_expression>", FOLLOW_BOOL_EXPRESSION);
+            return condition;
         }
     
-        expect("RELOP");
+        condition.jumpIfTrue = BytecodeCompiler::relation(currentToken.value);
+        expect(TOKEN_RELOP);
         
-        if (currentToken.type == "IDENTIFIER") {
+        if (currentToken.kind == TOKEN_IDENTIFIER) {
             string secondVarName = currentToken.value;
+            condition.right = slotOf(currentToken);
     
-            if (symbolTable.find(secondVarName) == symbolTable.end()) {
-                error("Переменная " + secondVarName + " не объявлена.", {"SEMICOLON"});
-                cout << "ASSIGN " << currentToken.type << endl;
-            } else if (symbolTable[secondVarName] != firstOperandType) {
-                error("Несоответствие типов в булевом выражении: " + firstOperandType + " и " + symbolTable[secondVarName]);
+            if (!symbolTable.contains(secondVarName)) {
+                error("Переменная " + secondVarName + " не объявлена.", FOLLOW_BOOL_EXPRESSION);
+                tracer.trace<TRACE_RECOVERY>("ASSIGN ", currentToken.type);
+            } else if (symbolTable.get(secondVarName) != firstOperandType) {
+                error("Несоответствие типов в булевом выражении: " + firstOperandType + " и " + symbolTable.get(secondVarName));
+            } else {
+                advance();
             }
-        } else if(currentToken.type == "NUMBER") {
+        } else if(currentToken.kind == TOKEN_NUMBER) {
             string secondVarName = currentToken.value;
+            condition.right = slotOf(currentToken);
             advance();
             
         } else {
             error("Ожидался идентификатор после оператора отношения.");
         }
+        return condition;
     }
 
 
     // <if> ::= 'if' '(' <bool_expression> ')'
-    void ifStatement() {
-        expect("LPAREN");
-        boolExpression();
-        expect("RPAREN");
+    Condition ifStatement() {
+        expect(TOKEN_LPAREN);
+        Condition condition = boolExpression();
+        expect(TOKEN_RPAREN);
+        return condition;
     }
 
     // Запуск парсера
     void parse() {
         program();
         if (errorCount == 0) {
-            cout << "Синтаксический анализ успешно завершен." << endl;
+            output << "Синтаксический анализ успешно завершен." << endl;
         } else {
-            cout << "Обнаружено ошибок: " << errorCount << endl;
+            output << "Обнаружено ошибок: " << errorCount << endl;
         }
     }
 };
 
-int main() {
+// Документ для инкрементальной проверки: после правки заново лексируется
+// только повреждённый участок, а разбираются заново только операторы,
+// которые его охватывают; остальные берутся из кэша
+class IncrementalDocument {
+private:
+    string text;
+    vector<Token> tokens;
+    vector<StatementMemo> memo;
+
+public:
+    // Статистика последней правки и разбора
+    size_t relexedTokens = 0;
+    size_t reusedStatements = 0;
+    size_t parsedStatements = 0;
+
+    IncrementalDocument(const string& filename) {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Ошибка при открытии файла: " + filename);
+        }
+        text.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+        Lexer lexer(text, 0, 1);
+        do {
+            tokens.push_back(lexer.nextToken());
+        } while (tokens.back().kind != TOKEN_EOF);
+        memo.resize(tokens.size());
+        relexedTokens = tokens.size();
+    }
+
+    // Замена removed символов с позиции offset на inserted
+    void edit(size_t offset, size_t removed, const string& inserted) {
+        size_t oldEnd = offset + removed;
+        long long delta = (long long)inserted.size() - (long long)removed;
+        int lineDelta = 0;
+        text.replace(offset, removed, inserted);
+
+        // Первый токен, который мог измениться: вместе с символом предпросмотра он доходит до правки
+        size_t first = partition_point(tokens.begin(), tokens.end(), [offset](const Token& token) {
+            return token.offset + token.length < offset;
+        }) - tokens.begin();
+        size_t startPos = first > 0 ? tokens[first - 1].offset + tokens[first - 1].length : 0;
+        int startLine = first > 0 ? tokens[first - 1].line : 1;
+
+        // Лексируем, пока новый токен не совпадёт с началом старого токена за правкой
+        Lexer lexer(text, startPos, startLine);
+        vector<Token> fresh;
+        size_t resume = first;
+        while (true) {
+            Token token = lexer.nextToken();
+            while (resume < tokens.size() && (long long)tokens[resume].offset + delta < (long long)token.offset) {
+                resume++;
+            }
+            if (resume < tokens.size() && tokens[resume].offset >= oldEnd
+                && (long long)tokens[resume].offset + delta == (long long)token.offset) {
+                lineDelta = token.line - tokens[resume].line;
+                break;
+            }
+            fresh.push_back(token);
+            if (token.kind == TOKEN_EOF) {
+                resume = tokens.size();
+                break;
+            }
+        }
+
+        // Токены за повреждённым участком только сдвигаются
+        for (size_t i = resume; i < tokens.size(); i++) {
+            tokens[i].offset += delta;
+            tokens[i].line += lineDelta;
+        }
+        tokens.erase(tokens.begin() + first, tokens.begin() + resume);
+        tokens.insert(tokens.begin() + first, fresh.begin(), fresh.end());
+
+        // Операторы, просматривавшие повреждённые токены, разбираются заново
+        for (size_t i = 0; i < first; i++) {
+            if (memo[i].valid && i + memo[i].tokenCount > first) {
+                memo[i] = StatementMemo();
+            }
+        }
+        memo.erase(memo.begin() + first, memo.begin() + resume);
+        memo.insert(memo.begin() + first, fresh.size(), StatementMemo());
+        relexedTokens = fresh.size();
+    }
+
+    // Замена строки с номером lineNumber (с 1)
+    bool replaceLine(int lineNumber, const string& newLine) {
+        size_t start = 0;
+        for (int line = 1; line < lineNumber; line++) {
+            start = text.find('\n', start);
+            if (start == string::npos) {
+                return false;
+            }
+            start++;
+        }
+        size_t end = text.find('\n', start);
+        if (end == string::npos) {
+            end = text.size();
+        }
+        edit(start, end - start, newLine);
+        return true;
+    }
+
+    int parse(ostream& diagnostics = cerr, ostream& output = cout, int traceLevel = compiledTraceLevel) {
+        Parser parser(tokens, memo, diagnostics, output);
+        parser.setTraceLevel(traceLevel);
+        parser.parse();
+        reusedStatements = parser.getReusedStatements();
+        parsedStatements = parser.getParsedStatements();
+        return parser.getErrorCount();
+    }
+};
+
+// Интерактивная проверка файла с правками построчно
+int runIncremental(const string& filename, int traceLevel) {
+    IncrementalDocument document(filename);
+    while (true) {
+        auto start = chrono::steady_clock::now();
+        document.parse(cerr, cout, traceLevel);
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Перелексировано токенов: " << document.relexedTokens
+             << ", операторов разобрано: " << document.parsedStatements
+             << ", взято из кэша: " << document.reusedStatements
+             << ", время разбора: " << elapsed << " мс" << endl;
+
+        cout << "Правка (<номер строки> <новый текст>, пустая строка - выход): ";
+        string command;
+        if (!getline(cin, command) || command.empty()) {
+            break;
+        }
+        size_t space = command.find(' ');
+        int lineNumber = atoi(command.substr(0, space).c_str());
+        string newLine = space == string::npos ? "" : command.substr(space + 1);
+        if (lineNumber <= 0 || !document.replaceLine(lineNumber, newLine)) {
+            cerr << "Нет строки " << command.substr(0, space) << endl;
+        }
+    }
+    return 0;
+}
+
+// Программа из size объявлений в одном блоке
+void generateProgram(ostream& out, size_t size) {
+    out << "int main ( ) {\n{\n";
+    for (size_t i = 0; i < size; i++) {
+        out << "int value" << i << " = " << i << " ;\n";
+    }
+    out << "}\n}\n";
+}
+
+// Программа с ошибкой в каждом операторе: пропущенная ';', необъявленная
+// переменная, лишние токены, - вперемешку с правильными циклами. Оператор i
+// стоит в строке BROKEN_FIRST_LINE + i
+const int BROKEN_FIRST_LINE = 4;
+
+void generateBrokenProgram(ostream& out, size_t size) {
+    out << "int main ( ) {\n{\nint n = 3 ;\n";
+    for (size_t i = 0; i < size; i++) {
+        switch (i % 4) {
+        case 0: out << "int a" << i << " = 5\n"; break;
+        case 1: out << "int b" << i << " = undefined" << i << " ;\n"; break;
+        case 2: out << "= = ; 7\n"; break;
+        default: out << "for ( int i = 0 ; i < n ; ) { int d = i ; }\n"; break;
+        }
+    }
+    out << "return 0 ; }\n}\n";
+}
+
+// Сравнение обычного и конвейерного режимов на сгенерированных программах
+int runPipelineBenchmark(const vector<size_t>& sizes) {
+    const int repeats = 5;
+    string path = (filesystem::temp_directory_path() / "lab4_pipeline_bench.txt").string();
+
+    cout << "Объявлений\tОбычный, мс\tКонвейер, мс\tУскорение" << endl;
+    for (size_t size : sizes) {
+        {
+            ofstream file(path);
+            generateProgram(file, size);
+        }
+
+        double best[2] = {1e300, 1e300};
+        for (int repeat = 0; repeat < repeats; repeat++) {
+            for (int mode = 0; mode < 2; mode++) {
+                ostringstream sink;
+                auto start = chrono::steady_clock::now();
+                Parser parser(path, mode == 1, sink, sink);
+                parser.parse();
+                double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                best[mode] = min(best[mode], elapsed);
+            }
+        }
+        cout << size << "\t" << best[0] << "\t" << best[1] << "\t" << best[0] / best[1] << endl;
+    }
+    filesystem::remove(path);
+    return 0;
+}
+
+// Результат выполнения байт-кода
+struct ExecutionResult {
+    bool returned = false;    // Выполнен return
+    bool outOfFuel = false;   // Исчерпан лимит переходов
+    int64_t value = 0;
+    uint64_t instructions = 0;
+};
+
+// Интерпретатор байт-кода с выбором команды через switch. fuel - число
+// выполненных переходов до остановки, больше нуля: в языке нет арифметики,
+// поэтому цикл с истинным условием не завершается сам
+ExecutionResult runSwitch(const Bytecode& bytecode, uint64_t fuel) {
+    vector<int64_t> slots = bytecode.slots;
+    int64_t* s = slots.data();
+    const Instruction* code = bytecode.code.data();
+    ExecutionResult result;
+    size_t pc = 0;
+    uint64_t count = 0;
+    while (true) {
+        const Instruction& in = code[pc];
+        count++;
+        switch (in.op) {
+        case OP_MOVE: s[in.a] = s[in.b]; pc++; continue;
+        case OP_JUMP: pc = in.target; break;
+        case OP_JUMP_LT: if (s[in.a] < s[in.b]) { pc = in.target; break; } pc++; continue;
+        case OP_JUMP_GT: if (s[in.a] > s[in.b]) { pc = in.target; break; } pc++; continue;
+        case OP_JUMP_EQ: if (s[in.a] == s[in.b]) { pc = in.target; break; } pc++; continue;
+        case OP_JUMP_NE: if (s[in.a] != s[in.b]) { pc = in.target; break; } pc++; continue;
+        case OP_JUMP_GE: if (s[in.a] >= s[in.b]) { pc = in.target; break; } pc++; continue;
+        case OP_JUMP_LE: if (s[in.a] <= s[in.b]) { pc = in.target; break; } pc++; continue;
+        case OP_RETURN:
+            result.returned = true;
+            result.value = s[in.a];
+            result.instructions = count;
+            return result;
+        case OP_HALT:
+            result.instructions = count;
+            return result;
+        }
+        // Сюда попадаем только после выполненного перехода
+        if (--fuel == 0) {
+            result.outOfFuel = true;
+            result.instructions = count;
+            return result;
+        }
+    }
+}
+
+#ifdef __GNUC__
+#define VM_THREADED 1
+#endif
+
+#ifdef VM_THREADED
+// Шитый код: перед запуском каждая команда получает адрес своего обработчика,
+// и обработчик переходит к следующему напрямую, без общего switch
+ExecutionResult runThreaded(const Bytecode& bytecode, uint64_t fuel) {
+    static const void* const handlers[] = {
+        &&op_move, &&op_jump, &&op_jump_lt, &&op_jump_gt, &&op_jump_eq,
+        &&op_jump_ne, &&op_jump_ge, &&op_jump_le, &&op_return, &&op_halt};
+
+    struct ThreadedInstruction {
+        const void* handler;
+        int32_t a, b, target;
+    };
+    vector<ThreadedInstruction> program;
+    program.reserve(bytecode.code.size());
+    for (const Instruction& in : bytecode.code) {
+        program.push_back({handlers[in.op], in.a, in.b, in.target});
+    }
+
+    vector<int64_t> slots = bytecode.slots;
+    int64_t* s = slots.data();
+    const ThreadedInstruction* code = program.data();
+    const ThreadedInstruction* in = code;
+    ExecutionResult result;
+    uint64_t count = 1;
+
+#define VM_NEXT() do { in++; count++; goto *in->handler; } while (0)
+#define VM_TAKEN() do { if (--fuel == 0) goto out_of_fuel; in = code + in->target; count++; goto *in->handler; } while (0)
+    goto *in->handler;
+
+op_move:
+    s[in->a] = s[in->b];
+    VM_NEXT();
+op_jump:
+    VM_TAKEN();
+op_jump_lt:
+    if (s[in->a] < s[in->b]) VM_TAKEN();
+    VM_NEXT();
+op_jump_gt:
+    if (s[in->a] > s[in->b]) VM_TAKEN();
+    VM_NEXT();
+op_jump_eq:
+    if (s[in->a] == s[in->b]) VM_TAKEN();
+    VM_NEXT();
+op_jump_ne:
+    if (s[in->a] != s[in->b]) VM_TAKEN();
+    VM_NEXT();
+op_jump_ge:
+    if (s[in->a] >= s[in->b]) VM_TAKEN();
+    VM_NEXT();
+op_jump_le:
+    if (s[in->a] <= s[in->b]) VM_TAKEN();
+    VM_NEXT();
+op_return:
+    result.returned = true;
+    result.value = s[in->a];
+    result.instructions = count;
+    return result;
+op_halt:
+    result.instructions = count;
+    return result;
+out_of_fuel:
+    result.outOfFuel = true;
+    result.instructions = count;
+    return result;
+#undef VM_NEXT
+#undef VM_TAKEN
+}
+#endif
+
+ExecutionResult execute(const Bytecode& bytecode, uint64_t fuel) {
+#ifdef VM_THREADED
+    return runThreaded(bytecode, fuel);
+#else
+    return runSwitch(bytecode, fuel);
+#endif
+}
+
+// Разбор с построением байт-кода; false, если в программе есть ошибки
+bool compileProgram(const string& filename, Bytecode& bytecode, ostream& diagnostics, ostream& output) {
+    BytecodeCompiler compiler;
+    Parser parser(filename, diagnostics, output);
+    parser.setCompiler(&compiler);
+    parser.parse();
+    bytecode = compiler.finish();
+    return parser.getErrorCount() == 0;
+}
+
+// Запуск программы: --run <файл> [лимит переходов], с --dump - и вывод байткода
+int runProgram(const string& filename, uint64_t fuel, bool dump) {
+    Bytecode bytecode;
+    if (!compileProgram(filename, bytecode, cerr, cout)) {
+        return 1;
+    }
+    if (dump) {
+        static const char* const names[] = {"MOVE", "JUMP", "JUMP_LT", "JUMP_GT", "JUMP_EQ", "JUMP_NE", "JUMP_GE", "JUMP_LE", "RETURN", "HALT"};
+        for (size_t pc = 0; pc < bytecode.code.size(); pc++) {
+            const Instruction& in = bytecode.code[pc];
+            cout << pc << "\t" << names[in.op];
+            if (in.op == OP_MOVE || (in.op >= OP_JUMP_LT && in.op <= OP_JUMP_LE)) {
+                cout << " " << bytecode.slotNames[in.a] << ", " << bytecode.slotNames[in.b];
+            } else if (in.op == OP_RETURN) {
+                cout << " " << bytecode.slotNames[in.a];
+            }
+            if (in.op >= OP_JUMP && in.op <= OP_JUMP_LE) {
+                cout << " -> " << in.target;
+            }
+            cout << endl;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    ExecutionResult result = execute(bytecode, fuel);
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (result.returned) {
+        cout << "Результат: ";
+        if (bytecode.functionType == "bool") {
+            cout << (result.value ? "true" : "false") << endl;
+        } else {
+            cout << result.value << endl;
+        }
+    } else if (result.outOfFuel) {
+        cout << "Выполнение прервано: исчерпан лимит переходов (" << fuel << ")" << endl;
+    } else {
+        cout << "Программа завершилась без return" << endl;
+    }
+    cout << "Команд байт-кода: " << bytecode.code.size() << ", слотов: " << bytecode.slots.size()
+         << ", выполнено команд: " << result.instructions << " за " << elapsed << " мс" << endl;
+    return 0;
+}
+
+// Программы с циклами для замеров: тело цикла бесконечно, выполнение
+// ограничено лимитом переходов
+vector<pair<string, string>> benchmarkPrograms() {
+    string moves, branches, nested;
+    for (int i = 0; i < 8; i++) {
+        moves += "int v" + to_string(i) + " = " + (i ? "v" + to_string(i - 1) : string("i")) + " ;\n";
+        branches += "if ( v < " + to_string(i * 2) + " ) { int w = " + to_string(i) + " ; }\n";
+    }
+    nested = "for ( int j = 0 ; j < 1 ; ) { int j = 5 ; } int k = j ;\n"
+             "for ( int m = 3 ; m > 1 ; ) { int m = 0 ; int n = m ; } int p = n ;\n";
+    return {
+        {"пустой цикл", "int main ( ) { for ( int i = 0 ; i < 10 ; ) { } return i ; }"},
+        {"присваивания", "int main ( ) { for ( int i = 0 ; i < 10 ; ) {\n" + moves + "} return i ; }"},
+        {"ветвления", "int main ( ) { for ( int i = 0 ; i < 10 ; ) {\nint v = 7 ;\n" + branches + "} return i ; }"},
+        {"вложенные циклы", "int main ( ) { for ( int i = 0 ; i < 10 ; ) {\n" + nested + "} return i ; }"},
+        {"сравнение переменных", "int main ( ) { {\nint n = 10 ;\nint m = 3 ;\nfor ( int i = 0 ; i < n ; ) {\n"
+            "int a = i ;\nif ( a == n ) { int a = m ; }\nif ( m > a ) { int b = m ; }\nif ( a < b ) { int b = a ; }\n"
+            "if ( n != b ) { int i = m ; }\n} return i ; } }"},
+    };
+}
+
+// Оба интерпретатора должны выполнить программу одинаково: тот же результат
+// и то же число команд. false и сообщение в cerr, если это не так
+bool vmResultsAgree(const string& name, const Bytecode& bytecode, uint64_t fuel) {
+#ifdef VM_THREADED
+    ExecutionResult expected = runSwitch(bytecode, fuel);
+    ExecutionResult actual = runThreaded(bytecode, fuel);
+    if (expected.returned != actual.returned || expected.outOfFuel != actual.outOfFuel
+        || expected.value != actual.value || expected.instructions != actual.instructions) {
+        cerr << name << ": результаты switch и шитого кода различаются" << endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Сравнение выбора команд через switch и шитого кода: --bench-vm [лимит переходов]
+int runVmBenchmark(uint64_t fuel) {
+    const int repeats = 3;
+    string path = (filesystem::temp_directory_path() / "lab4_vm_bench.txt").string();
+    cout << "Программа\tКоманд\tswitch, млн/с";
+#ifdef VM_THREADED
+    cout << "\tШитый код, млн/с\tУскорение";
+#endif
+    cout << endl;
+
+    for (const auto& [name, source] : benchmarkPrograms()) {
+        {
+            ofstream file(path);
+            file << source;
+        }
+        Bytecode bytecode;
+        ostringstream messages;
+        if (!compileProgram(path, bytecode, messages, messages)) {
+            cerr << name << ": " << messages.str();
+            filesystem::remove(path);
+            return 1;
+        }
+        if (!vmResultsAgree(name, bytecode, fuel)) {
+            filesystem::remove(path);
+            return 1;
+        }
+
+        double best[2] = {1e300, 1e300};
+        uint64_t executed[2] = {0, 0};
+        for (int repeat = 0; repeat < repeats; repeat++) {
+            for (int mode = 0; mode < 2; mode++) {
+                auto start = chrono::steady_clock::now();
+#ifdef VM_THREADED
+                ExecutionResult result = mode == 0 ? runSwitch(bytecode, fuel) : runThreaded(bytecode, fuel);
+#else
+                ExecutionResult result = runSwitch(bytecode, fuel);
+#endif
+                best[mode] = min(best[mode], chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+                executed[mode] = result.instructions;
+            }
+        }
+        cout << name << "\t" << executed[0] << "\t" << executed[0] / best[0] / 1000;
+#ifdef VM_THREADED
+        cout << "\t" << executed[1] / best[1] / 1000 << "\t" << best[0] / best[1];
+#endif
+        cout << endl;
+    }
+    filesystem::remove(path);
+    return 0;
+}
+
+// Пул потоков с перехватом задач: у каждого потока своя очередь,
+// свободный поток забирает задачи из конца чужих очередей
+class WorkStealingPool {
+private:
+    struct WorkQueue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<WorkQueue> queues;
+    atomic<size_t> pending;
+
+public:
+    WorkStealingPool(size_t threadCount) : queues(max<size_t>(threadCount, 1)), pending(0) {}
+
+    // Число потоков, выполняющих задачи, вместе с вызвавшим run()
+    size_t threadCount() const {
+        return queues.size();
+    }
+
+    // Задачи раздаются по очередям по кругу
+    void submit(function<void()> task) {
+        size_t index = pending++ % queues.size();
+        lock_guard<mutex> guard(queues[index].lock);
+        queues[index].tasks.push_back(std::move(task));
+    }
+
+    // Запуск всех задач и ожидание их завершения
+    void run() {
+        vector<thread> workers;
+        for (size_t i = 1; i < queues.size(); i++) {
+            workers.emplace_back([this, i] { work(i); });
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+private:
+    bool take(size_t self, function<void()>& task) {
+        {
+            lock_guard<mutex> guard(queues[self].lock);
+            if (!queues[self].tasks.empty()) {
+                task = std::move(queues[self].tasks.front());
+                queues[self].tasks.pop_front();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); offset++) {
+            WorkQueue& victim = queues[(self + offset) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t self) {
+        function<void()> task;
+        while (pending.load() > 0) {
+            if (take(self, task)) {
+                task();
+                pending--;
+            } else {
+                this_thread::yield();
+            }
+        }
+    }
+};
+
+// Результат разбора одного файла
+struct FileResult {
+    string filename;
+    string diagnostics;  // Ошибки и итоговое сообщение парсера
+    int errorCount = 0;
+    bool opened = true;
+    double milliseconds = 0;
+};
+
+// Разбор одного файла собственными Parser/Lexer
+FileResult parseFile(const string& filename, int traceLevel, bool pipelined) {
+    FileResult result;
+    result.filename = filename;
+    auto start = chrono::steady_clock::now();
+    ostringstream messages;
+    try {
+        Parser parser(filename, pipelined, messages, messages);
+        parser.setTraceLevel(traceLevel);
+        parser.parse();
+        result.errorCount = parser.getErrorCount();
+    } catch (const exception& err) {
+        messages << err.what() << endl;
+        result.opened = false;
+    }
+    result.diagnostics = messages.str();
+    result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Раскрытие аргументов: файлы, каталоги (все *.txt) и шаблоны glob
+vector<string> expandInputs(const vector<string>& inputs) {
+    vector<string> files;
+    for (const auto& input : inputs) {
+        vector<string> expanded;
+        if (filesystem::is_directory(input)) {
+            for (const auto& entry : filesystem::directory_iterator(input)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+                    expanded.push_back(entry.path().string());
+                }
+            }
+        } else if (input.find_first_of("*?[") != string::npos) {
+            glob_t matches;
+            if (glob(input.c_str(), 0, nullptr, &matches) == 0) {
+                for (size_t i = 0; i < matches.gl_pathc; i++) {
+                    expanded.push_back(matches.gl_pathv[i]);
+                }
+            }
+            globfree(&matches);
+        } else {
+            expanded.push_back(input);
+        }
+        sort(expanded.begin(), expanded.end());
+        files.insert(files.end(), expanded.begin(), expanded.end());
+    }
+    return files;
+}
+
+// Параллельная проверка нескольких файлов; вывод в порядке аргументов
+int runDriver(const vector<string>& files, size_t threadCount, int traceLevel, bool pipelined) {
+    vector<FileResult> results(files.size());
+    auto start = chrono::steady_clock::now();
+
+    WorkStealingPool pool(min(threadCount, max<size_t>(files.size(), 1)));
+    for (size_t i = 0; i < files.size(); i++) {
+        pool.submit([&results, &files, i, traceLevel, pipelined] {
+            results[i] = parseFile(files[i], traceLevel, pipelined);
+        });
+    }
+    pool.run();
+
+    double wallTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    int totalErrors = 0, failedFiles = 0, unreadable = 0;
+    double sumTime = 0;
+    for (const auto& result : results) {
+        cout << "== " << result.filename << " (" << result.milliseconds << " мс)" << endl;
+        cout << result.diagnostics;
+        totalErrors += result.errorCount;
+        if (!result.opened) {
+            unreadable++;
+        } else if (result.errorCount > 0) {
+            failedFiles++;
+        }
+        sumTime += result.milliseconds;
+    }
+
+    cout << "Файлов: " << files.size() << ", с ошибками: " << failedFiles
+         << ", не открыто: " << unreadable << ", всего ошибок: " << totalErrors << endl;
+    cout << "Время: " << wallTime << " мс (сумма по файлам " << sumTime << " мс, потоков " << pool.threadCount() << ")" << endl;
+    return (totalErrors > 0 || unreadable > 0) ? 1 : 0;
+}
+
+#ifdef LAB_BENCHMARK
+// Проверка восстановления перед замерами: правильные циклы между ошибочными
+// операторами (условие i < n из двух переменных) не дают ни одной ошибки.
+// Операторов меньше MAX_DIAGNOSTICS, чтобы разбор дошёл до конца
+bool checkRecovery(const string& path) {
+    const size_t size = 40;
+    {
+        ofstream file(path);
+        generateBrokenProgram(file, size);
+    }
+    ostringstream messages, sink;
+    Parser parser(path, messages, sink);
+    parser.parse();
+
+    const string prefix = "Ошибка в строке ";
+    istringstream lines(messages.str());
+    string line;
+    while (getline(lines, line)) {
+        if (line.rfind(prefix, 0) != 0) {
+            continue;
+        }
+        int statement = stoi(line.substr(prefix.size())) - BROKEN_FIRST_LINE;
+        if (statement >= 0 && statement % 4 == 3) {
+            cerr << "Восстановление: ошибка в правильном операторе: " << line << endl;
+            return false;
+        }
+    }
+    if (parser.getErrorCount() == 0) {
+        cerr << "Восстановление: не найдены ошибки в ошибочных операторах" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Задержки разбора, восстановления после ошибок, повторного разбора после
+// правки и выполнения байт-кода на сгенерированных программах
+int runLatencyBenchmark(double scale) {
+    auto temp = [](const string& name) {
+        return (filesystem::temp_directory_path() / name).string();
+    };
+    string programPath = temp("lab4_bench_program.txt");
+    string brokenPath = temp("lab4_bench_broken.txt");
+    if (!checkRecovery(brokenPath)) {
+        return 1;
+    }
+    {
+        ofstream program(programPath);
+        generateProgram(program, 2000);
+        ofstream broken(brokenPath);
+        generateBrokenProgram(broken, 2000);
+    }
+    size_t programBytes = filesystem::file_size(programPath);
+    size_t brokenBytes = filesystem::file_size(brokenPath);
+
+    auto parseFile = [](const string& path, bool pipelined) {
+        ostringstream sink;
+        Parser parser(path, pipelined, sink, sink);
+        parser.parse();
+        return size_t(parser.getErrorCount());
+    };
+
+    printLatencyHeader(cout);
+    printLatency(cout, "разбор (2000 объявлений)", measureLatency(scaled(500, scale), programBytes, [&](size_t) {
+        return parseFile(programPath, false);
+    }));
+    printLatency(cout, "разбор с конвейером", measureLatency(scaled(500, scale), programBytes, [&](size_t) {
+        return parseFile(programPath, true);
+    }));
+    printLatency(cout, "разбор с ошибками", measureLatency(scaled(500, scale), brokenBytes, [&](size_t) {
+        return parseFile(brokenPath, false);
+    }));
+
+    // Правка одной строки и повторный разбор: токены и операторы берутся из кэша
+    IncrementalDocument document(programPath);
+    ostringstream sink;
+    document.parse(sink, sink);
+    printLatency(cout, "правка и повторный разбор", measureLatency(scaled(2000, scale), 0, [&](size_t i) {
+        int line = 3 + i % 2000;
+        document.replaceLine(line, "int value" + to_string(line - 3) + " = " + to_string(i) + " ;");
+        sink.str("");
+        return size_t(document.parse(sink, sink));
+    }));
+
+    for (const auto& [name, source] : benchmarkPrograms()) {
+        {
+            ofstream file(programPath);
+            file << source;
+        }
+        Bytecode bytecode;
+        ostringstream messages;
+        if (!compileProgram(programPath, bytecode, messages, messages)) {
+            cerr << name << ": " << messages.str();
+            return 1;
+        }
+        if (!vmResultsAgree(name, bytecode, 10000)) {
+            return 1;
+        }
+        printLatency(cout, "VM: " + name, measureLatency(scaled(2000, scale), 0, [&](size_t) {
+            return execute(bytecode, 10000).instructions;
+        }));
+    }
+    filesystem::remove(programPath);
+    filesystem::remove(brokenPath);
+    return 0;
+}
+
+// Исполняемый файл lab_4_bench: вместо разбора 6.txt - замеры, lab_4_bench [множитель объёма]
+int main(int argc, char* argv[]) {
+    try {
+        return runLatencyBenchmark(benchScale(argc, argv));
+    } catch (const exception& err) {
+        cerr << err.what() << endl;
+        return 1;
+    }
+}
+#else
+int main(int argc, char* argv[]) {
     string filename = "6";
     // cout << "Файл: ";
     // getline(cin, filename);
 
-    Parser parser((filename + ".txt").c_str());
-    parser.parse();
+    // Уровень трассировки времени выполнения: --trace=N или переменная PARSER_TRACE
+    int traceLevel = compiledTraceLevel;
+    const char* traceEnv = getenv("PARSER_TRACE");
+    if (traceEnv) {
+        traceLevel = atoi(traceEnv);
+    }
+
+    // Остальные аргументы: -j N, --pipeline, --dump, --bench-pipeline [размеры], --incremental <файл>,
+    // --run <файл> [лимит переходов], --bench-vm [лимит переходов] и список файлов, каталогов или шаблонов.
+    // Режим запускается после разбора всех аргументов, чтобы параметры после него тоже действовали;
+    // из нескольких режимов выполняется последний
+    size_t threadCount = max(thread::hardware_concurrency(), 1u);
+    vector<string> inputs;
+    bool pipelined = false;
+    bool dump = false;
+    string mode;
+    string modeFile;
+    vector<size_t> sizes;
+    uint64_t fuel = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--trace=", 0) == 0) {
+            traceLevel = atoi(arg.c_str() + 8);
+        } else if (arg == "--pipeline") {
+            pipelined = true;
+        } else if (arg == "--dump") {
+            dump = true;
+        } else if (arg == "--bench-pipeline") {
+            mode = arg;
+            sizes.clear();
+            while (i + 1 < argc && isdigit(argv[i + 1][0])) {
+                sizes.push_back(stoul(argv[++i]));
+            }
+            if (sizes.empty()) {
+                sizes = {1000, 10000, 100000, 500000};
+            }
+        } else if (arg == "--incremental" && i + 1 < argc) {
+            mode = arg;
+            modeFile = argv[++i];
+        } else if (arg == "--run" && i + 1 < argc) {
+            mode = arg;
+            modeFile = argv[++i];
+            fuel = i + 1 < argc && isdigit(argv[i + 1][0]) ? stoull(argv[++i]) : 100000000;
+        } else if (arg == "--bench-vm") {
+            mode = arg;
+            fuel = i + 1 < argc && isdigit(argv[i + 1][0]) ? stoull(argv[++i]) : 20000000;
+        } else if (arg == "-j" && i + 1 < argc) {
+            threadCount = max(atoi(argv[++i]), 1);
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    // Лимит проверяется при уменьшении после перехода, поэтому 0 означал бы отсутствие лимита
+    if ((mode == "--run" || mode == "--bench-vm") && fuel == 0) {
+        cerr << "Лимит переходов должен быть больше нуля" << endl;
+        return 1;
+    }
+    if (mode == "--bench-pipeline") {
+        return runPipelineBenchmark(sizes);
+    }
+    if (mode == "--bench-vm") {
+        return runVmBenchmark(fuel);
+    }
+    if (mode == "--incremental" || mode == "--run") {
+        try {
+            return mode == "--run" ? runProgram(modeFile, fuel, dump) : runIncremental(modeFile, traceLevel);
+        } catch (const exception& err) {
+            cerr << err.what() << endl;
+            return 1;
+        }
+    }
+
+    if (!inputs.empty()) {
+        return runDriver(expandInputs(inputs), threadCount, traceLevel, pipelined);
+    }
+
+    try {
+        Parser parser(filename + ".txt", pipelined);
+        parser.setTraceLevel(traceLevel);
+        parser.parse();
+    } catch (const exception& err) {
+        cerr << err.what() << endl;
+        return 1;
+    }
 
     return 0;
 }
+#endif
@@ -1,184 +1,1859 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <sstream>
 #include <vector>
 #include <map>
+#include <string_view>
+#include <iterator>
+#include <cstdint>
+#include <charconv>
+#include <climits>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <filesystem>
+#include <new>
+#include <memory>
+#include <cstdlib>
+#ifdef LAB_BENCHMARK
+#include <sys/resource.h>
+#include "../bench/bench.h"
+#endif
 
 using namespace std;
 
-string getAnsiColor(int textcolor, int bgcolor) {
-    stringstream ss;
-    ss << "\033[" << (30 + textcolor % 8) << ";"; // Цвет текста (30-37)
-    ss << (40 + bgcolor % 8) << "m";              // Цвет фона (40-47)
-    return ss.str();
+const int PAGE_WIDTH = 80;  // Ширина консоли
+unsigned renderThreads = max(thread::hardware_concurrency(), 1u);  // Потоки раскладки и отрисовки
+
+#ifdef LAB_BENCHMARK
+// Счётчик выделений памяти. Замена operator new есть только в lab_6_bench:
+// в обычной программе каждое выделение обходилось бы в атомарную операцию
+atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* memory = malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw bad_alloc();
+}
+
+// Память из operator new выше получена через malloc, поэтому free здесь парный вызов
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+#pragma GCC diagnostic pop
+#endif
+
+// Вывод через заранее выделенный буфер: символы копируются в него,
+// а в поток уходят только заполненные блоки
+class OutputBuffer {
+private:
+    ostream& stream;
+    vector<char> data;
+    size_t used = 0;
+
+public:
+    explicit OutputBuffer(ostream& stream, size_t capacity = 1 << 16) : stream(stream), data(capacity) {}
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    OutputBuffer& operator+=(char ch) {
+        if (used == data.size()) {
+            drain();
+        }
+        data[used++] = ch;
+        return *this;
+    }
+
+    OutputBuffer& operator+=(string_view text) {
+        if (text.size() > data.size() - used) {
+            drain();
+            if (text.size() > data.size()) {
+                stream.write(text.data(), text.size());
+                return *this;
+            }
+        }
+        copy(text.begin(), text.end(), data.begin() + used);
+        used += text.size();
+        return *this;
+    }
+
+    // Всё накопленное - в поток
+    void flush() {
+        drain();
+        stream.flush();
+    }
+
+private:
+    void drain() {
+        stream.write(data.data(), used);
+        used = 0;
+    }
+};
+
+void appendNumber(OutputBuffer& out, int value) {
+    char digits[12];
+    char* end = to_chars(digits, digits + sizeof(digits), value).ptr;
+    out += string_view(digits, end - digits);
+}
+
+// Escape-последовательность цвета (0-7 - обычные цвета, 8-15 - яркие)
+void appendAnsiColor(OutputBuffer& out, int textcolor, int bgcolor) {
+    textcolor &= 15;
+    bgcolor &= 15;
+    out += "\033[";
+    appendNumber(out, textcolor < 8 ? 30 + textcolor : 90 + textcolor - 8); // Цвет текста
+    out += ';';
+    appendNumber(out, bgcolor < 8 ? 40 + bgcolor : 100 + bgcolor - 8);      // Цвет фона
+    out += 'm';
 }
 
 string resetAnsiColor() {
     return "\033[0m";  // Сброс цветов
 }
 
-int getIndent(const string& halign, int columnWidth, const string& text) {
-    int textLength = text.length();
+// Выравнивание; значение UNSET наследуется от родителя
+enum HAlign : uint8_t { HALIGN_LEFT, HALIGN_CENTER, HALIGN_RIGHT, HALIGN_UNSET };
+enum VAlign : uint8_t { VALIGN_TOP, VALIGN_CENTER, VALIGN_BOTTOM, VALIGN_UNSET };
+
+int getIndent(HAlign halign, int columnWidth, int textLength) {
     if (columnWidth <= 0) {
         return 0; // Если ширина колонки некорректна, не добавляем отступы
     }
     
-    if (halign == "center") {
+    switch (halign) {
+    case HALIGN_CENTER:
         return max((columnWidth - textLength) / 2, 0); // Не допускаем отрицательных отступов
-    } else if (halign == "right") {
+    case HALIGN_RIGHT:
         return max(columnWidth - textLength, 0); // Не допускаем отрицательных отступов
+    default:
+        return 0; // По умолчанию - выравнивание влево
     }
-    
-    return 0; // По умолчанию - выравнивание влево
 }
 
-// Структуры для хранения данных
-struct Column {
-    string valign = "top";
-    string halign = "left";
-    int textcolor = 15;  // По умолчанию белый текст
-    int bgcolor = 0;     // По умолчанию чёрный фон
-    int width = 0;
-    string text;
+// Отступ сверху для вертикального выравнивания
+int getVerticalIndent(VAlign valign, int rowHeight, int contentHeight) {
+    switch (valign) {
+    case VALIGN_CENTER:
+        return max((rowHeight - contentHeight) / 2, 0);
+    case VALIGN_BOTTOM:
+        return max(rowHeight - contentHeight, 0);
+    default:
+        return 0;
+    }
+}
+
+// Добавление кодовой точки в кодировке UTF-8
+void appendUtf8(OutputBuffer& out, char32_t ch) {
+    if (ch < 0x80) {
+        out += char(ch);
+    } else if (ch < 0x800) {
+        out += char(0xC0 | (ch >> 6));
+        out += char(0x80 | (ch & 0x3F));
+    } else if (ch < 0x10000) {
+        out += char(0xE0 | (ch >> 12));
+        out += char(0x80 | ((ch >> 6) & 0x3F));
+        out += char(0x80 | (ch & 0x3F));
+    } else {
+        out += char(0xF0 | (ch >> 18));
+        out += char(0x80 | ((ch >> 12) & 0x3F));
+        out += char(0x80 | ((ch >> 6) & 0x3F));
+        out += char(0x80 | (ch & 0x3F));
+    }
+}
+
+// Текст в кодовые точки: переводы строк и отступы схлопываются в один пробел
+vector<char32_t> decodeText(string_view text) {
+    vector<char32_t> result;
+    bool space = false;
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = text[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            space = true;
+            i++;
+            continue;
+        }
+        if (space && !result.empty()) {
+            result.push_back(' ');
+        }
+        space = false;
+
+        int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        char32_t ch = extra == 0 ? c : c & (0x3F >> extra);
+        i++;
+        for (int k = 0; k < extra && i < text.size(); k++, i++) {
+            ch = (ch << 6) | (text[i] & 0x3F);
+        }
+        result.push_back(ch);
+    }
+    return result;
+}
+
+// Виды узлов документа
+enum NodeKind { NODE_BLOCK, NODE_ROW, NODE_COLUMN, NODE_TEXT };
+
+const int NO_NODE = -1;
+const int UNSET = -1;  // Атрибут не задан и наследуется от родителя
+const uint8_t COLOR_UNSET = 0xFF;
+
+// Оформление узла: 4 байта вместо строк. Объявленное в тэге оформление
+// может содержать незаданные поля, итоговое - уже нет
+struct Style {
+    VAlign valign = VALIGN_TOP;
+    HAlign halign = HALIGN_LEFT;
+    uint8_t textcolor = 15;  // По умолчанию белый текст
+    uint8_t bgcolor = 0;     // По умолчанию чёрный фон
+
+    uint32_t key() const {
+        return valign | halign << 8 | textcolor << 16 | uint32_t(bgcolor) << 24;
+    }
+
+    Style inherit(const Style& declared) const {
+        Style style = *this;
+        if (declared.valign != VALIGN_UNSET) style.valign = declared.valign;
+        if (declared.halign != HALIGN_UNSET) style.halign = declared.halign;
+        if (declared.textcolor != COLOR_UNSET) style.textcolor = declared.textcolor;
+        if (declared.bgcolor != COLOR_UNSET) style.bgcolor = declared.bgcolor;
+        return style;
+    }
 };
 
-struct Row {
-    string valign = "top";
-    string halign = "left";
-    int textcolor = 15;
-    int bgcolor = 0;
-    int height = 1;
-    vector<Column> columns;
+const Style NO_STYLE{VALIGN_UNSET, HALIGN_UNSET, COLOR_UNSET, COLOR_UNSET};
+
+// Таблица различных сочетаний оформления; узлы ссылаются на неё по номеру.
+// Номер 0 - оформление по умолчанию
+class StyleTable {
+private:
+    vector<Style> styles;
+    unordered_map<uint32_t, uint16_t> lookup;
+
+public:
+    StyleTable() {
+        intern(Style());
+    }
+
+    uint16_t intern(const Style& style) {
+        auto found = lookup.find(style.key());
+        if (found != lookup.end()) {
+            return found->second;
+        }
+        styles.push_back(style);
+        return lookup[style.key()] = styles.size() - 1;
+    }
+
+    const Style& operator[](uint16_t index) const {
+        return styles[index];
+    }
+
+    size_t size() const {
+        return styles.size();
+    }
 };
 
-struct Block {
-    int rows = 0;
+// Узел дерева документа. Узлы лежат подряд в одном векторе и ссылаются
+// друг на друга по индексам, поэтому память растёт линейно с размером документа
+struct Node {
+    NodeKind kind;
+    int parent = NO_NODE;
+    int firstChild = NO_NODE;
+    int lastChild = NO_NODE;
+    int nextSibling = NO_NODE;
+
+    uint16_t declaredStyle = 0;  // Оформление из атрибутов тэга
+    uint16_t style = 0;          // Итоговое оформление с учётом родителей
+    int width = UNSET;       // Только для <column>
+    int height = UNSET;      // Только для <row>
+    int rows = 0;            // Только для <block>
     int columns = 1;
-    vector<Row> rowsData;
-};
-
-int safeStoi(const string& str, int defaultValue = 0) {
-    if (str.empty()) {
-        return defaultValue;
-    }
-    try {
-        return stoi(str);
-    } catch (const invalid_argument&) {
-        cout << "Error: " << str << endl;
-        return defaultValue;
-    }
-}
-
-// Парсинг атрибутов
-map<string, string> parseAttributes(const string& tag) {
-    map<string, string> attributes;
-    istringstream iss(tag);
-    string token;
-    while (iss >> token) {
-        auto pos = token.find('=');
-        if (pos != string::npos) {
-            auto key = token.substr(0, pos);
-            auto value = token.substr(pos + 1);
-            attributes[key] = value;
-        }
-    }
-    return attributes;
-}
-
-// Вывод блока
-void printBlock(const Block& block) {
-    for (const auto& row : block.rowsData) {
-        for (const auto& column : row.columns) {
-            
-            cout << getAnsiColor(column.textcolor, column.bgcolor);
-            
-            int indent = getIndent(column.halign, column.width, column.text);
-            cout << string(indent, ' ') << column.text << "\n"; // Выводим текст с отступом
-            
-            cout << resetAnsiColor();
-        }
-    }
-}
-
-Block parseEmark(const string& filename) {
-    ifstream file(filename);
-    string line;
-    Block block;
-    Row currentRow;
-    Column currentColumn;
-    bool inBlock = false, inRow = false, inColumn = false;
-
-    while (getline(file, line)) {
-        if (line.find("<block") != string::npos) {
-            cout << "BLOCK " << endl;
-            auto attrs = parseAttributes(line);
-            block.rows = safeStoi(attrs["rows"], 0);      // Количество строк
-            block.columns = safeStoi(attrs["columns"], 1); // Количество столбцов
-            inBlock = true;
-        } else if (line.find("<row") != string::npos) {
-            cout << "ROW " << endl;
-            auto attrs = parseAttributes(line);
-            currentRow.valign = attrs["valign"];
-            currentRow.halign = attrs["halign"];
-            currentRow.height = safeStoi(attrs["height"], 1);
-            currentRow.textcolor = safeStoi(attrs["textcolor"], 15);
-            currentRow.bgcolor = safeStoi(attrs["bgcolor"], 0);
-            currentRow.height = safeStoi(attrs["height"], 1);
-            inRow = true;
-        } else if (line.find("<column") != string::npos) {
-            auto attrs = parseAttributes(line);
-            cout << "COLUMN " << endl;
-            currentColumn.valign = attrs["valign"];
-            currentColumn.halign = attrs["halign"];
-            currentColumn.textcolor = safeStoi(attrs["textcolor"], 15); // Белый по умолчанию
-            currentColumn.bgcolor = safeStoi(attrs["bgcolor"], 0);      // Чёрный по умолчанию
-            currentColumn.width = safeStoi(attrs["width"], 80);         // Ширина столбца по умолчанию
-            inColumn = true;
-        } else if (line.find("</column>") != string::npos) {
-            cout << "COLUMN CLOSE " << endl;
-            currentRow.columns.push_back(currentColumn);
-            block.rowsData.push_back(currentRow);
-            if (inRow) {
-                inRow = false;
-            }
-            currentColumn = Column(); // Сбросить текущий столбец
-            currentRow = Row();       // Сбросить текущую строку
-            inColumn = false;
-        } else if (line.find("</row>") != string::npos) {
-            cout << "ROW CLOSE " << endl;
-            block.rowsData.push_back(currentRow);
-            currentRow = Row(); // Сбросить текущую строку
-            inRow = false;
-        } else if (line.find("</block>") != string::npos) {
-            cout << "BLOCK CLOSE " << endl;
-            inBlock = false;
-        } else if (inColumn) {
-            currentColumn.text += line; // Добавить текст в текущий столбец
-        } else if (inRow) {
-            // Если находимся в строке, добавляем текст в текущий столбец
-            if (currentRow.columns.empty()) {
-                currentColumn = Column();
-                currentColumn.bgcolor = currentRow.bgcolor;
-                currentColumn.textcolor = currentRow.textcolor;
-                currentColumn.valign = currentRow.valign;
-                currentColumn.halign = currentRow.halign;
-            }
-            currentColumn.text += line; // Добавить текст в текущий столбец
-            if (currentRow.columns.empty()) {
-                currentRow.columns.push_back(currentColumn);
-            }
-        }
-    }
-
-    return block;
-}
-
-int main() {
+
+    size_t textOffset = 0;   // Текст узла NODE_TEXT в исходном буфере
+    size_t textLength = 0;
+    uint64_t hash = 0;       // Отпечаток поддерева: одинаковые поддеревья раскладываются одинаково
+
+    Node(NodeKind kind, int parent) : kind(kind), parent(parent) {}
+};
+
+// Документ: исходный текст и дерево узлов; корень - nodes[0],
+// остальные элементы верхнего уровня связаны с ним через nextSibling
+struct Document {
+    string source;
+    vector<Node> nodes;
+    StyleTable styles;
+    int lastTopLevel = 0;  // Последний элемент верхнего уровня: к нему добавляется следующий
+
+    // Добавление узла последним потомком parent
+    int addNode(NodeKind kind, int parent) {
+        int index = nodes.size();
+        nodes.emplace_back(kind, parent);
+        if (parent != NO_NODE) {
+            Node& owner = nodes[parent];
+            if (owner.lastChild == NO_NODE) {
+                owner.firstChild = index;
+            } else {
+                nodes[owner.lastChild].nextSibling = index;
+            }
+            owner.lastChild = index;
+        } else if (index > 0) {
+            nodes[lastTopLevel].nextSibling = index;
+            lastTopLevel = index;
+        }
+        return index;
+    }
+
+    string_view text(const Node& node) const {
+        return string_view(source).substr(node.textOffset, node.textLength);
+    }
+
+    // Отпечатки поддеревьев; потомки в векторе всегда правее родителя
+    void computeHashes() {
+        for (size_t i = nodes.size(); i-- > 0;) {
+            Node& node = nodes[i];
+            uint64_t hash = hashValue(0xcbf29ce484222325ULL, node.kind);
+            int numbers[] = {int(styles[node.declaredStyle].key()), node.width, node.height, node.rows, node.columns};
+            hash = hashBytes(hash, numbers, sizeof(numbers));
+            string_view content = text(node);
+            hash = hashBytes(hash, content.data(), content.size());
+            for (int child = node.firstChild; child != NO_NODE; child = nodes[child].nextSibling) {
+                hash = hashValue(hash, nodes[child].hash);
+            }
+            node.hash = hash;
+        }
+    }
+
+private:
+    static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+        }
+        return hashValue(hash, size);
+    }
+
+    static uint64_t hashValue(uint64_t hash, uint64_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        return hash * 0xbf58476d1ce4e5b9ULL;
+    }
+};
+
+// Разбор числа без исключений; false для пустой строки, мусора и выхода за [minValue, maxValue]
+bool parseNumber(string_view str, int minValue, int maxValue, int& value) {
+    int result = 0;
+    auto [end, error] = from_chars(str.data(), str.data() + str.size(), result);
+    if (error != errc() || end != str.data() + str.size() || result < minValue || result > maxValue) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+// Атрибут тэга: имя и значение указывают в исходный буфер
+struct EmarkAttribute {
+    string_view name;
+    string_view value;
+};
+
+// Типы лексем разметки
+enum EmarkTokenType {
+    EMARK_OPEN_TAG,   // <name attr=value ...>
+    EMARK_CLOSE_TAG,  // </name>
+    EMARK_TEXT,       // Текст между тэгами (без пробелов по краям)
+    EMARK_ERROR,      // Незакрытый тэг
+    EMARK_NEED_MORE,  // Лексема не помещается в буфер, нужны следующие данные
+    EMARK_END         // Конец буфера
+};
+
+struct EmarkToken {
+    EmarkTokenType type;
+    string_view name;                              // Имя тэга
+    string_view text;                              // Текст или сообщение об ошибке
+    const vector<EmarkAttribute>* attributes;      // Атрибуты открывающего тэга
+    int line;                                      // Строка начала лексемы
+
+    // Значение атрибута или пустая строка
+    string_view attribute(string_view key) const {
+        for (const auto& attribute : *attributes) {
+            if (attribute.name == key) {
+                return attribute.value;
+            }
+        }
+        return {};
+    }
+};
+
+// Однопроходный лексический анализатор разметки по буферу в памяти.
+// Тэги могут идти по несколько в строке и переноситься на следующие строки
+class EmarkTokenizer {
+private:
+    string_view source;
+    size_t pos = 0;
+    int line = 1;
+    bool final;                         // Буфер содержит весь оставшийся текст
+    vector<EmarkAttribute> attributes;  // Переиспользуется между тэгами
+
+public:
+    EmarkTokenizer(string_view source, bool final = true) : source(source), final(final) {}
+
+    // Новое содержимое буфера при потоковом чтении; position - позиция разбора в нём
+    void feed(string_view newSource, bool isFinal, size_t position) {
+        source = newSource;
+        final = isFinal;
+        pos = position;
+    }
+
+    size_t position() const {
+        return pos;
+    }
+
+    EmarkToken next() {
+        while (pos < source.size()) {
+            if (source[pos] == '<') {
+                return readTag();
+            }
+            size_t start = pos;
+            int startLine = line;
+            size_t end = source.find('<', pos);
+            if (end == string_view::npos) {
+                if (!final) {
+                    return {EMARK_NEED_MORE, {}, {}, &attributes, line};
+                }
+                end = source.size();
+            }
+            countLines(start, end);
+            pos = end;
+            string_view text = trim(source.substr(start, end - start));
+            if (!text.empty()) {
+                return {EMARK_TEXT, {}, text, &attributes, startLine};
+            }
+        }
+        return {final ? EMARK_END : EMARK_NEED_MORE, {}, {}, &attributes, line};
+    }
+
+private:
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    static string_view trim(string_view text) {
+        size_t first = 0, last = text.size();
+        while (first < last && isSpace(text[first])) first++;
+        while (last > first && isSpace(text[last - 1])) last--;
+        return text.substr(first, last - first);
+    }
+
+    void countLines(size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            if (source[i] == '\n') line++;
+        }
+    }
+
+    void skipSpaces() {
+        while (pos < source.size() && isSpace(source[pos])) {
+            if (source[pos] == '\n') line++;
+            pos++;
+        }
+    }
+
+    // Слово до пробела, '=', '>' или '/'
+    string_view readWord() {
+        size_t start = pos;
+        while (pos < source.size() && !isSpace(source[pos]) && source[pos] != '=' && source[pos] != '>' && source[pos] != '/') {
+            pos++;
+        }
+        return source.substr(start, pos - start);
+    }
+
+    EmarkToken readTag() {
+        size_t start = pos;
+        int startLine = line;
+        pos++;  // '<'
+        bool closing = pos < source.size() && source[pos] == '/';
+        if (closing) pos++;
+        string_view name = readWord();
+        attributes.clear();
+
+        while (true) {
+            skipSpaces();
+            if (pos >= source.size()) {
+                if (!final) {
+                    // Тэг продолжается в следующей порции данных
+                    pos = start;
+                    line = startLine;
+                    return {EMARK_NEED_MORE, {}, {}, &attributes, line};
+                }
+                return {EMARK_ERROR, name, "незакрытый тэг", &attributes, startLine};
+            }
+            if (source[pos] == '>') {
+                pos++;
+                return {closing ? EMARK_CLOSE_TAG : EMARK_OPEN_TAG, name, {}, &attributes, startLine};
+            }
+            if (source[pos] == '/') {
+                pos++;
+                continue;
+            }
+
+            EmarkAttribute attribute{readWord(), {}};
+            skipSpaces();
+            if (pos < source.size() && source[pos] == '=') {
+                pos++;
+                skipSpaces();
+                if (pos < source.size() && source[pos] == '"') {
+                    size_t end = source.find('"', pos + 1);
+                    if (end == string_view::npos) {
+                        end = source.size();
+                    }
+                    attribute.value = source.substr(pos + 1, end - pos - 1);
+                    countLines(pos, end);
+                    pos = min(end + 1, source.size());
+                } else {
+                    attribute.value = readWord();
+                }
+            }
+            if (attribute.name.empty() && attribute.value.empty()) {
+                pos++;  // Пропускаем непонятный символ ('=' без имени)
+                continue;
+            }
+            attributes.push_back(attribute);
+        }
+    }
+};
+
+// Символ экрана с цветами
+struct Cell {
+    char32_t ch = ' ';
+    uint8_t textcolor = 15;
+    uint8_t bgcolor = 0;
+};
+
+// Кадр: двумерная сетка символов с атрибутами
+struct Grid {
+    int width;
+    int height;
+    vector<Cell> cells;
+
+    Grid(int width, int height) : width(width), height(height), cells(width * height) {}
+
+    Cell& at(int x, int y) {
+        return cells[y * width + x];
+    }
+};
+
+// Прямоугольник на экране
+struct Rect {
+    int x, y, width, height;
+
+    Rect intersect(const Rect& other) const {
+        int left = max(x, other.x), top = max(y, other.y);
+        int right = min(x + width, other.x + other.width), bottom = min(y + height, other.y + other.height);
+        return {left, top, max(right - left, 0), max(bottom - top, 0)};
+    }
+};
+
+// Собственные размеры узла: минимальная ширина (самое длинное слово)
+// и максимальная (текст без переносов)
+struct IntrinsicSize {
+    int minWidth = 0;
+    int maxWidth = 0;
+};
+
+// Раскладка узла при заданной ширине
+struct NodeLayout {
+    int height = 0;
+    vector<int> bandHeights;          // Высоты полос потомков
+    vector<int> columnWidths;         // Ширины столбцов всех полос подряд
+    vector<vector<char32_t>> lines;   // Строки текста после переноса (NODE_TEXT)
+};
+
+// Движок раскладки. Подряд идущие <column> образуют полосу и делят ширину
+// родителя: заданная ширина берётся как есть, остаток распределяется между
+// остальными столбцами по их минимальной и максимальной ширине. Остальные
+// потомки идут друг под другом. Результаты кэшируются по отпечатку поддерева
+// и ширине, поэтому неизменённое поддерево повторно не раскладывается.
+// Кэш двухпоколенный: записи, не использованные в кадре, удаляются в следующем
+class LayoutEngine {
+private:
+    const Document* document = nullptr;
+    const LayoutEngine* shared = nullptr;  // Основной движок для задач: его прошлый кадр только читается
+    unordered_map<uint64_t, IntrinsicSize> sizes, previousSizes;
+    unordered_map<uint64_t, NodeLayout> layouts, previousLayouts;
+
+public:
+    size_t computedLayouts = 0;  // Статистика последнего кадра
+    size_t reusedLayouts = 0;
+
+    // Начало кадра: документ может быть новым, кэш по отпечаткам сохраняется
+    void beginFrame(const Document& current) {
+        document = &current;
+        previousSizes = std::move(sizes);
+        previousLayouts = std::move(layouts);
+        sizes.clear();
+        layouts.clear();
+        computedLayouts = reusedLayouts = 0;
+    }
+
+    // Движок отдельной задачи: собственный кэш поверх прошлого кадра основного
+    void fork(const LayoutEngine& parent) {
+        document = parent.document;
+        shared = &parent;
+        sizes.clear();
+        layouts.clear();
+        previousSizes.clear();
+        previousLayouts.clear();
+        computedLayouts = reusedLayouts = 0;
+    }
+
+    // Копия результатов задачи для корня её поддерева
+    void adoptSize(const LayoutEngine& task, int index) {
+        uint64_t key = document->nodes[index].hash;
+        sizes[key] = task.sizes.at(key);
+    }
+
+    void adoptLayout(const LayoutEngine& task, int index, int width) {
+        uint64_t key = layoutKey(index, width);
+        layouts[key] = task.layouts.at(key);
+    }
+
+    // Перенос всего кэша задачи в основной движок
+    void join(LayoutEngine& task) {
+        sizes.merge(task.sizes);
+        layouts.merge(task.layouts);
+        computedLayouts += task.computedLayouts;
+        reusedLayouts += task.reusedLayouts;
+    }
+
+    const NodeLayout& layout(int index, int width) {
+        uint64_t key = layoutKey(index, width);
+        auto found = layouts.find(key);
+        if (found != layouts.end()) {
+            reusedLayouts++;
+            return found->second;
+        }
+        auto previous = previousLayouts.find(key);
+        if (previous != previousLayouts.end()) {
+            reusedLayouts++;
+            return layouts[key] = std::move(previous->second);
+        }
+        if (shared) {
+            auto cached = shared->previousLayouts.find(key);
+            if (cached != shared->previousLayouts.end()) {
+                reusedLayouts++;
+                return layouts[key] = cached->second;
+            }
+        }
+        computedLayouts++;
+        NodeLayout result = compute(index, width);
+        return layouts[key] = std::move(result);
+    }
+
+    IntrinsicSize intrinsicSize(int index) {
+        uint64_t key = document->nodes[index].hash;
+        auto found = sizes.find(key);
+        if (found != sizes.end()) {
+            return found->second;
+        }
+        IntrinsicSize size;
+        auto previous = previousSizes.find(key);
+        if (previous != previousSizes.end()) {
+            size = previous->second;
+        } else if (shared && shared->previousSizes.count(key)) {
+            size = shared->previousSizes.at(key);
+        } else {
+            size = computeIntrinsic(index);
+        }
+        sizes[key] = size;
+        return size;
+    }
+
+    // Конец полосы: либо подряд идущие столбцы, либо один узел другого вида
+    int bandEnd(int child) const {
+        const vector<Node>& nodes = document->nodes;
+        if (nodes[child].kind != NODE_COLUMN) {
+            return nodes[child].nextSibling;
+        }
+        while (child != NO_NODE && nodes[child].kind == NODE_COLUMN) {
+            child = nodes[child].nextSibling;
+        }
+        return child;
+    }
+
+    // Ширины столбцов полосы [first, end) внутри ширины width
+    vector<int> distributeColumns(int first, int end, int width) {
+        vector<int> widths;
+        vector<IntrinsicSize> autoSizes;
+        int used = 0, sumMin = 0, sumMax = 0;
+        for (int column = first; column != end; column = document->nodes[column].nextSibling) {
+            int columnWidth = document->nodes[column].width;
+            if (columnWidth == UNSET) {
+                IntrinsicSize size = intrinsicSize(column);
+                autoSizes.push_back(size);
+                sumMin += size.minWidth;
+                sumMax += size.maxWidth;
+            } else {
+                columnWidth = min(columnWidth, max(width - used, 0));
+                used += columnWidth;
+            }
+            widths.push_back(columnWidth);
+        }
+
+        int remaining = max(width - used, 0);
+        size_t autoIndex = 0, autoCount = autoSizes.size();
+        for (auto& columnWidth : widths) {
+            if (columnWidth != UNSET) {
+                continue;
+            }
+            const IntrinsicSize& size = autoSizes[autoIndex++];
+            if (autoIndex == autoCount) {
+                columnWidth = remaining;  // Последний столбец забирает остаток
+            } else if (sumMax <= remaining) {
+                columnWidth = size.maxWidth;
+            } else if (sumMin >= remaining) {
+                columnWidth = sumMin > 0 ? (long long)remaining * size.minWidth / sumMin : remaining / (int)autoCount;
+            } else {
+                columnWidth = size.minWidth + (long long)(remaining - sumMin) * (size.maxWidth - size.minWidth) / max(sumMax - sumMin, 1);
+            }
+            columnWidth = min(columnWidth, remaining);
+            remaining -= columnWidth;
+        }
+        return widths;
+    }
+
+private:
+    uint64_t layoutKey(int index, int width) const {
+        return document->nodes[index].hash * 0x9e3779b97f4a7c15ULL + width;
+    }
+
+    NodeLayout compute(int index, int width) {
+        const Node& node = document->nodes[index];
+        NodeLayout result;
+        if (node.kind == NODE_TEXT) {
+            result.lines = wrapText(decodeText(document->text(node)), width);
+            result.height = result.lines.size();
+            return result;
+        }
+
+        int height = 0;
+        for (int child = node.firstChild; child != NO_NODE; child = bandEnd(child)) {
+            int bandHeight = 0;
+            if (document->nodes[child].kind == NODE_COLUMN) {
+                int end = bandEnd(child);
+                vector<int> widths = distributeColumns(child, end, width);
+                size_t i = 0;
+                for (int column = child; column != end; column = document->nodes[column].nextSibling) {
+                    bandHeight = max(bandHeight, layout(column, widths[i++]).height);
+                }
+                result.columnWidths.insert(result.columnWidths.end(), widths.begin(), widths.end());
+            } else {
+                bandHeight = layout(child, width).height;
+            }
+            result.bandHeights.push_back(bandHeight);
+            height += bandHeight;
+        }
+
+        if (node.kind == NODE_ROW) {
+            result.height = node.height != UNSET ? node.height : max(height, 1);
+        } else {
+            result.height = height;
+        }
+        return result;
+    }
+
+    IntrinsicSize computeIntrinsic(int index) {
+        const Node& node = document->nodes[index];
+        IntrinsicSize size;
+        if (node.kind == NODE_TEXT) {
+            int word = 0;
+            for (char32_t ch : decodeText(document->text(node))) {
+                word = ch == ' ' ? 0 : word + 1;
+                size.minWidth = max(size.minWidth, word);
+                size.maxWidth++;
+            }
+            return size;
+        }
+        if (node.kind == NODE_COLUMN && node.width != UNSET) {
+            return {node.width, node.width};
+        }
+        for (int child = node.firstChild; child != NO_NODE; child = bandEnd(child)) {
+            IntrinsicSize band;
+            if (document->nodes[child].kind == NODE_COLUMN) {
+                for (int column = child; column != bandEnd(child); column = document->nodes[column].nextSibling) {
+                    IntrinsicSize columnSize = intrinsicSize(column);
+                    band.minWidth += columnSize.minWidth;
+                    band.maxWidth += columnSize.maxWidth;
+                }
+            } else {
+                band = intrinsicSize(child);
+            }
+            size.minWidth = max(size.minWidth, band.minWidth);
+            size.maxWidth = max(size.maxWidth, band.maxWidth);
+        }
+        return size;
+    }
+
+    // Перенос по словам; слово длиннее строки разрезается
+    static vector<vector<char32_t>> wrapText(const vector<char32_t>& text, int width) {
+        vector<vector<char32_t>> lines;
+        if (width <= 0 || text.empty()) {
+            return lines;
+        }
+        vector<char32_t> line;
+        size_t i = 0;
+        while (i < text.size()) {
+            size_t wordEnd = i;
+            while (wordEnd < text.size() && text[wordEnd] != ' ') wordEnd++;
+            size_t wordLength = wordEnd - i;
+
+            int needed = line.empty() ? wordLength : line.size() + 1 + wordLength;
+            if (needed <= width) {
+                if (!line.empty()) line.push_back(' ');
+                line.insert(line.end(), text.begin() + i, text.begin() + wordEnd);
+                i = wordEnd;
+            } else if (line.empty()) {
+                line.insert(line.end(), text.begin() + i, text.begin() + i + width);
+                i += width;
+            } else {
+                lines.push_back(std::move(line));
+                line.clear();
+                continue;
+            }
+            if (i < text.size() && text[i] == ' ') i++;
+        }
+        if (!line.empty()) {
+            lines.push_back(std::move(line));
+        }
+        return lines;
+    }
+};
+
+// Постоянный пул потоков: run раздаёт номера задач [0, count) и ждёт их завершения,
+// вызывающий поток тоже выполняет задачи
+class ThreadPool {
+private:
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake, done;
+    function<void(size_t)> job;
+    size_t count = 0;
+    atomic<size_t> next{0};
+    size_t active = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+public:
+    explicit ThreadPool(unsigned threads) {
+        for (unsigned i = 1; i < threads; i++) {
+            workers.emplace_back([this]() { loop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t size() const {
+        return workers.size() + 1;
+    }
+
+    void run(size_t taskCount, const function<void(size_t)>& task) {
+        {
+            lock_guard<mutex> guard(lock);
+            job = task;
+            count = taskCount;
+            next = 0;
+            active = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        work();
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [this]() { return active == 0; });
+    }
+
+private:
+    void work() {
+        for (size_t index; (index = next++) < count;) {
+            job(index);
+        }
+    }
+
+    void loop() {
+        uint64_t seen = 0;
+        while (true) {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [&]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            guard.unlock();
+            work();
+            guard.lock();
+            if (--active == 0) {
+                done.notify_one();
+            }
+        }
+    }
+};
+
+ThreadPool& renderPool() {
+    static ThreadPool pool(renderThreads);
+    return pool;
+}
+
+// Независимое поддерево: раскладывается и рисуется отдельной задачей в свою подсетку
+struct Subtree {
+    int root;
+    int width = 0;
+    Rect rect{0, 0, 0, 0};
+    Rect clip{0, 0, 0, 0};
+    LayoutEngine engine;
+    Grid grid{0, 0};
+
+    explicit Subtree(int root) : root(root) {}
+};
+
+// Отрисовка документа в сетку символов по результатам раскладки
+class GridRenderer {
+private:
+    static const size_t PARALLEL_MIN_NODES = 2048;  // Меньшие документы рисуются в одном потоке
+    static const int MIN_TASK_NODES = 64;           // Поддеревья меньше этого не дробятся
+
+    const Document& document;
+    LayoutEngine& engine;
+    vector<Subtree> subtrees;
+    vector<int> subtreeOf;  // Номер поддерева для его корня, иначе NO_NODE
+
+public:
+    GridRenderer(const Document& document, LayoutEngine& engine) : document(document), engine(engine) {}
+
+    // Кадр со всеми элементами верхнего уровня
+    Grid render(int width = PAGE_WIDTH) {
+        engine.beginFrame(document);
+        splitSubtrees();
+        if (!subtrees.empty()) {
+            layoutSubtrees(width);
+        }
+
+        int height = 0;
+        for (int index = firstTopLevel(); index != NO_NODE; index = document.nodes[index].nextSibling) {
+            height += engine.layout(index, width).height;
+        }
+        Grid grid(width, height);
+        int y = 0;
+        for (int index = firstTopLevel(); index != NO_NODE; index = document.nodes[index].nextSibling) {
+            int nodeHeight = engine.layout(index, width).height;
+            Rect rect{0, y, width, nodeHeight};
+            draw(grid, engine, index, rect, rect, true);
+            y += nodeHeight;
+        }
+
+        if (!subtrees.empty()) {
+            composeSubtrees(grid);
+        }
+        return grid;
+    }
+
+private:
+    int firstTopLevel() const {
+        return document.nodes.empty() ? NO_NODE : 0;
+    }
+
+    // Выбор независимых поддеревьев: самое тяжёлое дробится на потомков,
+    // пока задач меньше четырёх на поток. Текст остаётся у родителя: он не заливает фон
+    void splitSubtrees() {
+        const vector<Node>& nodes = document.nodes;
+        ThreadPool& pool = renderPool();
+        subtrees.clear();
+        subtreeOf.assign(nodes.size(), NO_NODE);
+        if (pool.size() < 2 || nodes.size() < PARALLEL_MIN_NODES) {
+            return;
+        }
+
+        vector<int> weight(nodes.size(), 1);
+        for (size_t i = nodes.size(); i-- > 1;) {
+            if (nodes[i].parent != NO_NODE) {
+                weight[nodes[i].parent] += weight[i];
+            }
+        }
+        auto splittable = [&](int index) {
+            if (nodes[index].firstChild == NO_NODE || weight[index] < MIN_TASK_NODES) {
+                return false;
+            }
+            for (int child = nodes[index].firstChild; child != NO_NODE; child = nodes[child].nextSibling) {
+                if (nodes[child].kind == NODE_TEXT) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        vector<int> frontier;
+        for (int index = firstTopLevel(); index != NO_NODE; index = nodes[index].nextSibling) {
+            frontier.push_back(index);
+        }
+        while (frontier.size() < pool.size() * 4) {
+            int heaviest = NO_NODE;
+            for (size_t i = 0; i < frontier.size(); i++) {
+                if (splittable(frontier[i]) && (heaviest == NO_NODE || weight[frontier[i]] > weight[frontier[heaviest]])) {
+                    heaviest = i;
+                }
+            }
+            if (heaviest == NO_NODE) {
+                break;
+            }
+            int parent = frontier[heaviest];
+            frontier.erase(frontier.begin() + heaviest);
+            for (int child = nodes[parent].firstChild; child != NO_NODE; child = nodes[child].nextSibling) {
+                frontier.push_back(child);
+            }
+        }
+
+        for (int index : frontier) {
+            if (nodes[index].kind != NODE_TEXT) {
+                subtreeOf[index] = subtrees.size();
+                subtrees.emplace_back(index);
+            }
+        }
+        if (subtrees.size() < 2) {
+            subtrees.clear();
+            subtreeOf.assign(nodes.size(), NO_NODE);
+        }
+    }
+
+    // Раскладка поддеревьев в пуле: сначала собственные размеры, от которых зависят
+    // ширины столбцов выше, затем сама раскладка при известной ширине
+    void layoutSubtrees(int width) {
+        ThreadPool& pool = renderPool();
+        pool.run(subtrees.size(), [&](size_t i) {
+            subtrees[i].engine.fork(engine);
+            subtrees[i].engine.intrinsicSize(subtrees[i].root);
+        });
+        for (Subtree& subtree : subtrees) {
+            engine.adoptSize(subtree.engine, subtree.root);
+        }
+
+        for (int index = firstTopLevel(); index != NO_NODE; index = document.nodes[index].nextSibling) {
+            assignWidths(index, width);
+        }
+        pool.run(subtrees.size(), [&](size_t i) {
+            subtrees[i].engine.layout(subtrees[i].root, subtrees[i].width);
+        });
+        for (Subtree& subtree : subtrees) {
+            engine.adoptLayout(subtree.engine, subtree.root, subtree.width);
+        }
+    }
+
+    // Ширины корней поддеревьев по тем же правилам, что и в раскладке
+    void assignWidths(int index, int width) {
+        const Node& node = document.nodes[index];
+        if (subtreeOf[index] != NO_NODE) {
+            subtrees[subtreeOf[index]].width = width;
+            return;
+        }
+        for (int child = node.firstChild; child != NO_NODE; child = engine.bandEnd(child)) {
+            if (document.nodes[child].kind == NODE_COLUMN) {
+                int end = engine.bandEnd(child);
+                vector<int> widths = engine.distributeColumns(child, end, width);
+                size_t i = 0;
+                for (int column = child; column != end; column = document.nodes[column].nextSibling) {
+                    assignWidths(column, widths[i++]);
+                }
+            } else {
+                assignWidths(child, width);
+            }
+        }
+    }
+
+    // Отрисовка поддеревьев в подсетки и сборка кадра
+    void composeSubtrees(Grid& grid) {
+        renderPool().run(subtrees.size(), [&](size_t i) {
+            Subtree& subtree = subtrees[i];
+            Rect visible = subtree.rect.intersect(subtree.clip);
+            subtree.grid = Grid(visible.width, visible.height);
+            Rect rect{subtree.rect.x - visible.x, subtree.rect.y - visible.y, subtree.rect.width, subtree.rect.height};
+            draw(subtree.grid, subtree.engine, subtree.root, rect, {0, 0, visible.width, visible.height}, false);
+        });
+        for (Subtree& subtree : subtrees) {
+            Rect visible = subtree.rect.intersect(subtree.clip);
+            if (visible.width == 0) {
+                engine.join(subtree.engine);
+                continue;
+            }
+            for (int y = 0; y < visible.height; y++) {
+                auto row = subtree.grid.cells.begin() + y * visible.width;
+                copy(row, row + visible.width, &grid.at(visible.x, visible.y + y));
+            }
+            engine.join(subtree.engine);
+        }
+    }
+
+    // split: корни поддеревьев только запоминают своё место, их рисуют задачи
+    void draw(Grid& grid, LayoutEngine& layouts, int index, const Rect& rect, const Rect& clip, bool split) {
+        if (split && subtreeOf[index] != NO_NODE) {
+            Subtree& subtree = subtrees[subtreeOf[index]];
+            subtree.rect = rect;
+            subtree.clip = clip;
+            return;
+        }
+        const Node& node = document.nodes[index];
+        const Style& style = document.styles[node.style];
+        Rect visible = rect.intersect(clip);
+        const NodeLayout& layout = layouts.layout(index, rect.width);
+
+        if (node.kind == NODE_TEXT) {
+            for (size_t row = 0; row < layout.lines.size(); row++) {
+                const vector<char32_t>& line = layout.lines[row];
+                int y = rect.y + row;
+                int x = rect.x + getIndent(style.halign, rect.width, line.size());
+                if (y < visible.y || y >= visible.y + visible.height) {
+                    continue;
+                }
+                for (size_t i = 0; i < line.size(); i++) {
+                    int cellX = x + i;
+                    if (cellX >= visible.x && cellX < visible.x + visible.width) {
+                        grid.at(cellX, y) = {line[i], style.textcolor, style.bgcolor};
+                    }
+                }
+            }
+            return;
+        }
+
+        // Заливка фона
+        for (int y = visible.y; y < visible.y + visible.height; y++) {
+            for (int x = visible.x; x < visible.x + visible.width; x++) {
+                grid.at(x, y) = {' ', style.textcolor, style.bgcolor};
+            }
+        }
+
+        // Последняя строка без заданной высоты забирает остаток
+        vector<int> heights = layout.bandHeights;
+        int total = 0, last = NO_NODE;
+        for (int child = node.firstChild; child != NO_NODE; child = layouts.bandEnd(child)) {
+            last = child;
+        }
+        for (int height : heights) {
+            total += height;
+        }
+        int y = rect.y;
+        if (last != NO_NODE && total < rect.height && document.nodes[last].kind == NODE_ROW && document.nodes[last].height == UNSET) {
+            heights.back() += rect.height - total;
+        } else {
+            y += getVerticalIndent(style.valign, rect.height, total);
+        }
+
+        size_t band = 0, column = 0;
+        for (int child = node.firstChild; child != NO_NODE; child = layouts.bandEnd(child), band++) {
+            int height = heights[band];
+            if (document.nodes[child].kind == NODE_COLUMN) {
+                int x = rect.x;
+                for (int current = child; current != layouts.bandEnd(child); current = document.nodes[current].nextSibling) {
+                    int width = layout.columnWidths[column++];
+                    draw(grid, layouts, current, {x, y, width, height}, visible, split);
+                    x += width;
+                }
+            } else {
+                draw(grid, layouts, child, {rect.x, y, rect.width, height}, visible, split);
+            }
+            y += height;
+        }
+    }
+};
+
+// Формат вывода кадра. Раскладка и сетка общие для всех форматов, эмиттер
+// только кодирует готовые символы; begin и end обрамляют последовательность кадров
+class FrameEmitter {
+public:
+    virtual ~FrameEmitter() = default;
+    virtual void begin(OutputBuffer&) {}
+    virtual void frame(const Grid& grid, OutputBuffer& out) = 0;
+    virtual void end(OutputBuffer&) {}
+};
+
+// Терминал: escape-последовательности, цвет выводится только при смене атрибутов
+class AnsiEmitter : public FrameEmitter {
+public:
+    void frame(const Grid& grid, OutputBuffer& out) override {
+        for (int y = 0; y < grid.height; y++) {
+            const Cell* previous = nullptr;
+            for (int x = 0; x < grid.width; x++) {
+                const Cell& cell = grid.cells[y * grid.width + x];
+                if (!previous || previous->textcolor != cell.textcolor || previous->bgcolor != cell.bgcolor) {
+                    appendAnsiColor(out, cell.textcolor, cell.bgcolor);
+                }
+                appendUtf8(out, cell.ch);
+                previous = &cell;
+            }
+            out += resetAnsiColor();
+            out += '\n';
+        }
+    }
+};
+
+// Простой текст для журналов: без цветов и без пробелов в конце строк
+class TextEmitter : public FrameEmitter {
+public:
+    void frame(const Grid& grid, OutputBuffer& out) override {
+        for (int y = 0; y < grid.height; y++) {
+            const Cell* row = &grid.cells[y * grid.width];
+            int length = grid.width;
+            while (length > 0 && row[length - 1].ch == ' ') {
+                length--;
+            }
+            for (int x = 0; x < length; x++) {
+                appendUtf8(out, row[x].ch);
+            }
+            out += '\n';
+        }
+    }
+};
+
+// HTML: кадр в <pre>, отрезки с одинаковыми цветами - в <span> с классами палитры
+class HtmlEmitter : public FrameEmitter {
+private:
+    static constexpr const char* palette[16] = {
+        "#000000", "#aa0000", "#00aa00", "#aa5500", "#0000aa", "#aa00aa", "#00aaaa", "#aaaaaa",
+        "#555555", "#ff5555", "#55ff55", "#ffff55", "#5555ff", "#ff55ff", "#55ffff", "#ffffff"};
+
+public:
+    void begin(OutputBuffer& out) override {
+        out += "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<style>\n";
+        out += "pre { margin: 0; font-family: monospace; line-height: 1.2; }\n";
+        for (int color = 0; color < 16; color++) {
+            out += ".f";
+            appendNumber(out, color);
+            out += " { color: ";
+            out += palette[color];
+            out += "; } .b";
+            appendNumber(out, color);
+            out += " { background: ";
+            out += palette[color];
+            out += "; }\n";
+        }
+        out += "</style>\n</head>\n<body>\n";
+    }
+
+    void frame(const Grid& grid, OutputBuffer& out) override {
+        out += "<pre>";
+        for (int y = 0; y < grid.height; y++) {
+            const Cell* previous = nullptr;
+            for (int x = 0; x < grid.width; x++) {
+                const Cell& cell = grid.cells[y * grid.width + x];
+                if (!previous || previous->textcolor != cell.textcolor || previous->bgcolor != cell.bgcolor) {
+                    if (previous) {
+                        out += "</span>";
+                    }
+                    out += "<span class=\"f";
+                    appendNumber(out, cell.textcolor & 15);
+                    out += " b";
+                    appendNumber(out, cell.bgcolor & 15);
+                    out += "\">";
+                }
+                switch (cell.ch) {
+                case '<': out += "&lt;"; break;
+                case '>': out += "&gt;"; break;
+                case '&': out += "&amp;"; break;
+                default: appendUtf8(out, cell.ch);
+                }
+                previous = &cell;
+            }
+            if (previous) {
+                out += "</span>";
+            }
+            out += '\n';
+        }
+        out += "</pre>\n";
+    }
+
+    void end(OutputBuffer& out) override {
+        out += "</body>\n</html>\n";
+    }
+};
+
+// Эмиттер по названию формата; nullptr для неизвестного
+unique_ptr<FrameEmitter> makeEmitter(string_view format) {
+    if (format == "ansi") {
+        return make_unique<AnsiEmitter>();
+    } else if (format == "text") {
+        return make_unique<TextEmitter>();
+    } else if (format == "html") {
+        return make_unique<HtmlEmitter>();
+    }
+    return nullptr;
+}
+
+// Одна раскладка документа и вывод во все заданные форматы
+void exportBlock(const Document& document, const vector<pair<FrameEmitter*, ostream*>>& targets) {
+    LayoutEngine engine;
+    Grid grid = GridRenderer(document, engine).render();
+    for (const auto& [emitter, stream] : targets) {
+        OutputBuffer out(*stream);
+        emitter->begin(out);
+        emitter->frame(grid, out);
+        emitter->end(out);
+    }
+}
+
+// Вывод документа одним кадром
+void printBlock(const Document& document, ostream& out = cout) {
+    AnsiEmitter emitter;
+    exportBlock(document, {{&emitter, &out}});
+}
+
+// Построение дерева документа из лексем со стеком открытых тэгов
+class DocumentBuilder {
+private:
+    Document& document;
+    vector<int> open;  // Стек открытых тэгов
+
+public:
+    DocumentBuilder(Document& document) : document(document) {}
+
+    size_t depth() const {
+        return open.size();
+    }
+
+    // Обработка лексемы; возвращает закрытый узел или NO_NODE
+    int handle(const EmarkToken& token) {
+        int parent = open.empty() ? NO_NODE : open.back();
+        if (token.type == EMARK_TEXT) {
+            int index = document.addNode(NODE_TEXT, parent);
+            document.nodes[index].textOffset = token.text.data() - document.source.data();
+            document.nodes[index].textLength = token.text.size();
+            document.nodes[index].style = inheritStyle(parent, NO_STYLE);
+        } else if (token.type == EMARK_OPEN_TAG) {
+            NodeKind kind;
+            if (token.name == "block") {
+                kind = NODE_BLOCK;
+            } else if (token.name == "row") {
+                kind = NODE_ROW;
+            } else if (token.name == "column") {
+                kind = NODE_COLUMN;
+            } else {
+                cout << "Error: строка " << token.line << ": неизвестный тэг <" << token.name << ">" << endl;
+                return NO_NODE;
+            }
+            int index = document.addNode(kind, parent);
+            Node& node = document.nodes[index];
+            Style declared = NO_STYLE;
+            declared.valign = VAlign(keywordAttribute(token, "valign", {"top", "center", "bottom"}, VALIGN_UNSET));
+            declared.halign = HAlign(keywordAttribute(token, "halign", {"left", "center", "right"}, HALIGN_UNSET));
+            declared.textcolor = numberAttribute(token, "textcolor", COLOR_UNSET, 15);
+            declared.bgcolor = numberAttribute(token, "bgcolor", COLOR_UNSET, 15);
+            node.declaredStyle = document.styles.intern(declared);
+            node.style = inheritStyle(parent, declared);
+            if (kind == NODE_BLOCK) {
+                node.rows = numberAttribute(token, "rows", 0);      // Количество строк
+                node.columns = numberAttribute(token, "columns", 1); // Количество столбцов
+            } else if (kind == NODE_ROW) {
+                node.height = numberAttribute(token, "height", UNSET);
+            } else {
+                node.width = numberAttribute(token, "width", UNSET);
+            }
+            open.push_back(index);
+        } else if (token.type == EMARK_CLOSE_TAG) {
+            // Закрывающий тэг должен соответствовать последнему открытому
+            bool matches = !open.empty() && (
+                (token.name == "block" && document.nodes[parent].kind == NODE_BLOCK) ||
+                (token.name == "row" && document.nodes[parent].kind == NODE_ROW) ||
+                (token.name == "column" && document.nodes[parent].kind == NODE_COLUMN));
+            if (matches) {
+                open.pop_back();
+                return parent;
+            }
+            cout << "Error: строка " << token.line << ": лишний закрывающий тэг </" << token.name << ">" << endl;
+        }
+        return NO_NODE;
+    }
+
+    void finish() {
+        if (!open.empty()) {
+            cout << "Error: не закрыто тэгов: " << open.size() << endl;
+        }
+        document.computeHashes();
+    }
+
+private:
+    // Итоговое оформление считается один раз при разборе: родитель уже разобран
+    uint16_t inheritStyle(int parent, const Style& declared) {
+        const Style& base = document.styles[parent == NO_NODE ? 0 : document.nodes[parent].style];
+        return document.styles.intern(base.inherit(declared));
+    }
+
+    void reportValue(const EmarkToken& token, string_view name, string_view value) {
+        cout << "Error: строка " << token.line << ": недопустимое значение " << name << "=" << value << endl;
+    }
+
+    // Числовой атрибут; при ошибке остаётся значение по умолчанию
+    int numberAttribute(const EmarkToken& token, string_view name, int defaultValue, int maxValue = INT_MAX) {
+        string_view value = token.attribute(name);
+        int result = defaultValue;
+        if (!value.empty() && !parseNumber(value, 0, maxValue, result)) {
+            reportValue(token, name, value);
+        }
+        return result;
+    }
+
+    // Номер ключевого слова в списке; при ошибке значение не задано
+    uint8_t keywordAttribute(const EmarkToken& token, string_view name, initializer_list<string_view> keywords, uint8_t unset) {
+        string_view value = token.attribute(name);
+        if (value.empty()) {
+            return unset;
+        }
+        uint8_t index = 0;
+        for (string_view keyword : keywords) {
+            if (value == keyword) {
+                return index;
+            }
+            index++;
+        }
+        reportValue(token, name, value);
+        return unset;
+    }
+};
+
+// Разбор документа в дерево за один проход по лексемам
+Document parseEmark(const string& filename) {
+    Document document;
+    ifstream file(filename, ios::binary);
+    document.source.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    EmarkTokenizer tokenizer(document.source);
+    DocumentBuilder builder(document);
+
+    for (EmarkToken token = tokenizer.next(); token.type != EMARK_END; token = tokenizer.next()) {
+        if (token.type == EMARK_ERROR) {
+            cout << "Error: строка " << token.line << ": " << token.text << " <" << token.name << endl;
+            break;
+        }
+        builder.handle(token);
+    }
+    builder.finish();
+
+    return document;
+}
+
+// Потоковый вывод: файл читается порциями, и каждая строка <row> внешнего
+// блока выводится сразу после закрывающего тэга, после чего её узлы и
+// прочитанный текст освобождаются. Память ограничена самой большой строкой
+int streamEmark(const string& filename, FrameEmitter& emitter) {
+    ifstream file;
+    if (filename != "-") {
+        file.open(filename, ios::binary);
+        if (!file.is_open()) {
+            cout << "Error: не удалось открыть файл " << filename << endl;
+            return 1;
+        }
+    }
+    istream& input = filename == "-" ? cin : file;
+
+    const size_t chunkSize = 1 << 16;
+    Document document;
+    DocumentBuilder builder(document);
+    EmarkTokenizer tokenizer(document.source, false);
+    LayoutEngine engine;
+    OutputBuffer out(cout);
+    emitter.begin(out);
+
+    auto output = [&]() {
+        document.computeHashes();
+        Grid grid = GridRenderer(document, engine).render();
+        emitter.frame(grid, out);
+        out.flush();
+    };
+
+    while (true) {
+        EmarkToken token = tokenizer.next();
+        if (token.type == EMARK_NEED_MORE) {
+            size_t size = document.source.size();
+            document.source.resize(size + chunkSize);
+            input.read(&document.source[size], chunkSize);
+            document.source.resize(size + input.gcount());
+            tokenizer.feed(document.source, !input, tokenizer.position());
+            continue;
+        }
+        if (token.type == EMARK_END) {
+            break;
+        }
+        if (token.type == EMARK_ERROR) {
+            cout << "Error: строка " << token.line << ": " << token.text << " <" << token.name << endl;
+            break;
+        }
+
+        int closed = builder.handle(token);
+        if (closed != NO_NODE && document.nodes[closed].kind == NODE_ROW && document.nodes[closed].parent == 0 && builder.depth() == 1) {
+            // Вывод накопленных потомков внешнего блока и освобождение памяти
+            output();
+            document.nodes.erase(document.nodes.begin() + 1, document.nodes.end());
+            document.nodes[0].firstChild = document.nodes[0].lastChild = NO_NODE;
+            document.lastTopLevel = 0;
+            if (tokenizer.position() >= chunkSize) {
+                // Прочитанный текст больше не нужен ни одному узлу
+                document.source.erase(0, tokenizer.position());
+                tokenizer.feed(document.source, !input, 0);
+            }
+        }
+    }
+
+    builder.finish();
+    if (!document.nodes.empty() && (document.nodes[0].firstChild != NO_NODE || document.nodes[0].nextSibling != NO_NODE)) {
+        output();
+    }
+    emitter.end(out);
+    return 0;
+}
+
+// Перерисовка живого документа: хранится предыдущий кадр, а в терминал
+// выводятся только перемещения курсора и изменившиеся символы
+class LiveRenderer {
+private:
+    LayoutEngine engine;
+    Grid previous{0, 0};
+    bool firstFrame = true;
+
+public:
+    size_t changedCells = 0;  // Статистика последнего кадра
+
+    void update(const Document& document, OutputBuffer& out) {
+        Grid grid = GridRenderer(document, engine).render();
+        changedCells = 0;
+        if (firstFrame) {
+            out += "\033[H\033[2J";
+            AnsiEmitter().frame(grid, out);
+            changedCells = grid.cells.size();
+            firstFrame = false;
+        } else {
+            diff(grid, out);
+        }
+        previous = std::move(grid);
+    }
+
+private:
+    static bool sameCell(const Cell& a, const Cell& b) {
+        return a.ch == b.ch && a.textcolor == b.textcolor && a.bgcolor == b.bgcolor;
+    }
+
+    static void moveCursor(OutputBuffer& out, int x, int y) {
+        out += "\033[";
+        appendNumber(out, y + 1);
+        out += ';';
+        appendNumber(out, x + 1);
+        out += 'H';
+    }
+
+    void diff(const Grid& grid, OutputBuffer& out) {
+        int cursorX = -1, cursorY = -1;
+        int textcolor = -1, bgcolor = -1;  // Текущие цвета терминала
+        for (int y = 0; y < grid.height; y++) {
+            for (int x = 0; x < grid.width; x++) {
+                const Cell& cell = grid.cells[y * grid.width + x];
+                bool existed = y < previous.height && x < previous.width;
+                if (existed && sameCell(cell, previous.cells[y * previous.width + x])) {
+                    continue;
+                }
+                if (cursorX != x || cursorY != y) {
+                    moveCursor(out, x, y);
+                }
+                if (cell.textcolor != textcolor || cell.bgcolor != bgcolor) {
+                    appendAnsiColor(out, cell.textcolor, cell.bgcolor);
+                    textcolor = cell.textcolor;
+                    bgcolor = cell.bgcolor;
+                }
+                appendUtf8(out, cell.ch);
+                cursorX = x + 1;
+                cursorY = y;
+                changedCells++;
+            }
+        }
+        if (textcolor != -1) {
+            out += resetAnsiColor();
+        }
+        // Кадр стал ниже: стираем лишние строки
+        moveCursor(out, 0, grid.height);
+        if (grid.height < previous.height) {
+            out += "\033[J";
+        }
+    }
+};
+
+// Слежение за файлом: при каждом изменении документ разбирается заново
+// и выводятся только отличия от предыдущего кадра
+int watchEmark(const string& filename, int intervalMs) {
+    LiveRenderer renderer;
+    OutputBuffer out(cout);
+    filesystem::file_time_type lastWrite{};
+    while (true) {
+        error_code error;
+        auto writeTime = filesystem::last_write_time(filename, error);
+        if (!error && writeTime != lastWrite) {
+            lastWrite = writeTime;
+            Document document = parseEmark(filename);
+            renderer.update(document, out);
+            out.flush();
+        }
+        this_thread::sleep_for(chrono::milliseconds(intervalMs));
+    }
+}
+
+// Разбор и раскладка один раз, затем вывод в каждый формат
+int exportEmark(const string& filename, const vector<string>& outputs) {
+    vector<unique_ptr<FrameEmitter>> emitters;
+    vector<unique_ptr<ofstream>> files;
+    vector<pair<FrameEmitter*, ostream*>> targets;
+    for (const string& output : outputs) {
+        size_t separator = output.find('=');
+        unique_ptr<FrameEmitter> emitter = makeEmitter(string_view(output).substr(0, separator));
+        if (separator == string::npos || !emitter) {
+            cout << "Error: ожидается <ansi|text|html>=<путь>: " << output << endl;
+            return 1;
+        }
+        string path = output.substr(separator + 1);
+        ostream* stream = &cout;
+        if (path != "-") {
+            files.push_back(make_unique<ofstream>(path, ios::binary));
+            if (!files.back()->is_open()) {
+                cout << "Error: не удалось открыть файл " << path << endl;
+                return 1;
+            }
+            stream = files.back().get();
+        }
+        emitters.push_back(std::move(emitter));
+        targets.emplace_back(emitters.back().get(), stream);
+    }
+
+    Document document = parseEmark(filename);
+    exportBlock(document, targets);
+    return 0;
+}
+
+#ifdef LAB_BENCHMARK
+// Поток, который всё отбрасывает: замеры не зависят от терминала
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+
+    streamsize xsputn(const char*, streamsize count) override {
+        return count;
+    }
+};
+
+// Синтетический документ по образцу 1.txt: внешний блок из rows строк,
+// в каждой вложенные блоки глубины depth по columns столбцов
+void generateBenchDocument(ostream& out, int rows, int depth, int columns) {
+    static const char* const words[] = {"qwe1", "asdf", "report", "total", "1233", "4441", "column", "value"};
+    size_t counter = 0;
+    // Номер в начале текста делает поддеревья различными, иначе раскладка берётся из кэша
+    auto text = [&](int wordCount) {
+        out << counter;
+        for (int i = 0; i < wordCount; i++) {
+            out << " " << words[counter++ % 8];
+        }
+    };
+    function<void(int)> block = [&](int level) {
+        out << "<block rows=2 columns=" << columns << ">\n";
+        for (int column = 0; column < columns; column++) {
+            out << "<column" << (column % 2 ? "" : " width=" + to_string(60 / columns / 2 + 3))
+                << " valign=" << (column % 3 == 0 ? "top" : column % 3 == 1 ? "center" : "bottom") << ">\n";
+            for (int row = 0; row < 2; row++) {
+                out << "<row halign=" << (row ? "right" : "center") << " bgcolor=" << (counter + row) % 16
+                    << " textcolor=" << (counter + 7) % 16 << (row ? "" : " height=3") << ">";
+                if (level > 1 && row == 1) {
+                    out << "\n";
+                    block(level - 1);
+                } else {
+                    text(2 + counter % 5);
+                }
+                out << "</row>\n";
+            }
+            out << "</column>\n";
+        }
+        out << "</block>\n";
+    };
+
+    out << "<block rows=" << rows << " columns=1>\n";
+    for (int row = 0; row < rows; row++) {
+        out << "<row bgcolor=" << row % 8 << ">\n";
+        if (depth > 0) {
+            block(depth);
+        } else {
+            text(8);
+        }
+        out << "</row>\n";
+    }
+    out << "</block>\n";
+}
+
+// Замеры на сгенерированных документах: задержки и пропускная способность
+// разбора, раскладки, растеризации и кодирования кадра по отдельности и всего
+// вывода целиком; затем выделения памяти на операцию и пиковая память процесса
+int runLatencyBenchmark(double scale) {
+    NullBuffer nullBuffer;
+    ostream sink(&nullBuffer);
+
+    struct Size {
+        int rows, depth, columns;
+        size_t count;  // Операций на замер при множителе 1
+    };
+    const Size sizes[] = {{20, 1, 3, 1000}, {200, 2, 3, 100}, {500, 2, 3, 30}};
+    struct Input {
+        string name;
+        string path;
+        size_t bytes;
+        Document document;
+    };
+    vector<Input> inputs;
+    cout << "Потоков: " << renderThreads << endl;
+    for (const Size& size : sizes) {
+        string name = to_string(size.rows) + "x" + to_string(size.depth) + "x" + to_string(size.columns);
+        string path = (filesystem::temp_directory_path() / ("lab6_bench_" + name + ".txt")).string();
+        {
+            ofstream file(path);
+            generateBenchDocument(file, size.rows, size.depth, size.columns);
+        }
+        Document document = parseEmark(path);
+        size_t bytes = filesystem::file_size(path);
+        cout << "Документ " << name << ": " << bytes / 1048576.0 << " МБ, узлов: " << document.nodes.size()
+             << ", стилей: " << document.styles.size() << endl;
+        inputs.push_back({name, path, bytes, std::move(document)});
+    }
+
+    // Выделения считаются за один отдельный прогон после замера, чтобы
+    // не мешать измерению задержек
+    vector<pair<string, size_t>> allocations;
+    auto run = [&](const string& name, size_t count, size_t bytes, auto operation) {
+        printLatency(cout, name, measureLatency(count, bytes, operation));
+        size_t before = allocationCount.load();
+        operation(0);
+        allocations.push_back({name, allocationCount.load() - before});
+    };
+
+    printLatencyHeader(cout);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const Input& input = inputs[i];
+        const Document& document = input.document;
+        size_t count = scaled(sizes[i].count, scale);
+        string suffix = " (" + input.name + ")";
+
+        run("parseEmark" + suffix, count, input.bytes, [&](size_t) {
+            return parseEmark(input.path).nodes.size();
+        });
+        // Новый движок на каждую операцию: раскладка без кэша прошлых кадров
+        run("раскладка" + suffix, count, input.bytes, [&](size_t) {
+            LayoutEngine engine;
+            engine.beginFrame(document);
+            size_t height = 0;
+            for (int index = 0; index != NO_NODE; index = document.nodes[index].nextSibling) {
+                height += engine.layout(index, PAGE_WIDTH).height;
+            }
+            return height;
+        });
+        // Движок с прошлым кадром того же документа: раскладка берётся из кэша,
+        // и время уходит на заполнение сетки
+        LayoutEngine warm;
+        GridRenderer(document, warm).render();
+        run("растеризация" + suffix, count, input.bytes, [&](size_t) {
+            return GridRenderer(document, warm).render().cells.size();
+        });
+        // Только кодирование готовой сетки в ANSI
+        LayoutEngine engine;
+        Grid grid = GridRenderer(document, engine).render();
+        AnsiEmitter emitter;
+        run("вывод ANSI" + suffix, count, input.bytes, [&](size_t) {
+            OutputBuffer out(sink);
+            emitter.frame(grid, out);
+            return grid.cells.size();
+        });
+        run("разбор и вывод" + suffix, count, input.bytes, [&](size_t) {
+            Document fresh = parseEmark(input.path);
+            printBlock(fresh, sink);
+            return fresh.nodes.size();
+        });
+    }
+    for (const Input& input : inputs) {
+        filesystem::remove(input.path);
+    }
+
+    cout << "Тест\tВыделений на операцию" << endl;
+    for (const auto& entry : allocations) {
+        cout << entry.first << "\t" << entry.second << endl;
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "Пиковая память: " << usage.ru_maxrss / 1024 << " МБ" << endl;
+    return 0;
+}
+
+// Исполняемый файл lab_6_bench: вместо диалога - замеры,
+// lab_6_bench [--threads N] [множитель объёма]
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && string(argv[1]) == "--threads") {
+        renderThreads = max(atoi(argv[2]), 1);
+        argc -= 2;
+        argv += 2;
+    }
+    return runLatencyBenchmark(benchScale(argc, argv));
+}
+#else
+int main(int argc, char* argv[]) {
+    // Число потоков раскладки и отрисовки: --threads N перед остальными параметрами
+    if (argc >= 3 && string(argv[1]) == "--threads") {
+        renderThreads = max(atoi(argv[2]), 1);
+        argc -= 2;
+        argv += 2;
+    }
+    // Режим слежения: --watch <файл> [период в мс]
+    if (argc >= 3 && string(argv[1]) == "--watch") {
+        return watchEmark(argv[2], argc >= 4 ? atoi(argv[3]) : 1000);
+    }
+    // Потоковый режим: --stream <файл или - для stdin> [ansi|text|html]
+    if (argc >= 3 && string(argv[1]) == "--stream") {
+        unique_ptr<FrameEmitter> emitter = makeEmitter(argc >= 4 ? argv[3] : "ansi");
+        if (!emitter) {
+            cout << "Error: неизвестный формат " << argv[3] << endl;
+            return 1;
+        }
+        return streamEmark(argv[2], *emitter);
+    }
+    // Вывод в несколько форматов за один разбор: --export <файл> <формат>=<путь или ->...
+    if (argc >= 4 && string(argv[1]) == "--export") {
+        return exportEmark(argv[2], vector<string>(argv + 3, argv + argc));
+    }
+
+    // Файл в командной строке: вывод без диалога
+    if (argc >= 2) {
+        if (!filesystem::exists(argv[1])) {
+            cout << "Error: нет файла " << argv[1] << endl;
+            return 1;
+        }
+        printBlock(parseEmark(argv[1]));
+        return 0;
+    }
+
     string filename = "1";
     cout << "Файл: ";
     getline(cin, filename);
-    Block block = parseEmark(filename + ".txt");
-    printBlock(block);
+    Document document = parseEmark(filename + ".txt");
+    printBlock(document);
     return 0;
 }
+#endif